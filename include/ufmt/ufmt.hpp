@@ -1,12 +1,31 @@
 #pragma once
 
+#include <ctype.h>
+#include <stdio.h>
 #include <string.h>
+#include <limits>
+#include <type_traits>
 
 /* Forward declarations */
-namespace ufmt::detail { struct wrapper; }
+namespace ufmt::detail {
+
+struct wrapper;
+
+template <typename W, typename C>
+constexpr bool write_string( W &w, const C *str, size_t len, int type );
+
+template <typename W, typename C>
+constexpr bool write_debug( W &w, const C *str, size_t len, char quote );
+
+} // namespace ufmt::detail
 
+#include "ufmt_encode.hpp"
 #include "ufmt_writer.hpp"
 
+#if defined(UFMT_STATS)
+	#include "ufmt_stats.hpp"
+#endif
+
 namespace ufmt {
 
 struct format_desc
@@ -30,303 +49,1329 @@ struct format_desc
 
 	alignment align = alignment::none;
 
+	/* Raw spec text after ':', for formatters with a grammar of their own (e.g. chrono) */
+	const void *spec = nullptr;
+	size_t spec_length = 0;
+	size_t spec_char_size = 0;
+
+	int spec_char( size_t index ) const noexcept
+	{
+		if ( spec_char_size == 1 )
+			return static_cast<const unsigned char *>( spec )[index];
+		else if ( spec_char_size == 2 )
+			return static_cast<const char16_t *>( spec )[index];
+
+		return int( static_cast<const char32_t *>( spec )[index] );
+	}
+
 	template <typename C>
-	static format_desc parse(
-	    const C *valuePtrFormatStr,
-	    const detail::wrapper *const argPtrs,
-	    size_t numArgs,
-	    size_t valuePtrIndex );
+	static constexpr format_desc parse( const C *specStr, size_t specLength, size_t *numCharsUnparsed = nullptr );
+
+	template <typename C> constexpr bool parse_type( C ch ) noexcept;
+	template <typename C> constexpr void parse_fields( const C *chars, size_t numCharsLeft, size_t *numCharsUnparsed );
 };
 
 template <typename W, typename T> struct formatter
 {
 	static bool write( void *writerPtr, const void *valuePtr, const format_desc &fd )
 	{
-		W &w = *reinterpret_cast<W *>( writerPtr );
+		W &w = *reinterpret_cast<W *>( writerPtr );
+
+		const auto &value = *reinterpret_cast<const T *>( valuePtr );
+		return detail::write_string( w, data( value ), length( value ), fd.type );
+	}
+};
+
+template <typename W, typename T> struct formatter<W, T &>
+{
+	static bool write( void *writerPtr, const void *valuePtr, const format_desc &fd )
+	{
+		return formatter<W, T>::write( writerPtr, valuePtr, fd );
+	}
+};
+
+template <typename W, typename T> struct formatter<W, const T> : formatter<W, T> { };
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+using formatter_write_func = bool( * )( void *writerPtr, const void *valuePtr, const format_desc &fd );
+
+struct wrapper
+{
+	const void *ptr = nullptr;
+	formatter_write_func writeFunc = nullptr;
+};
+
+/* Literal run followed by an optional replacement field */
+template <typename C> struct format_segment
+{
+	const C *literal = nullptr;
+	size_t literal_length = 0;
+	size_t index = size_t( -1 );
+	size_t spec_unparsed = 0;
+	format_desc fd;
+};
+
+/* Format string split into segments once, so it can be replayed for many argument sets */
+template <typename C, size_t MaxSegments = 32> struct parsed_format
+{
+	format_segment<C> segments[MaxSegments];
+	size_t num_segments = 0;
+	size_t num_args = 0;
+	bool overflow = false;
+
+	constexpr parsed_format( const C *formatStr, size_t formatStrLen ) UFMT_NOEXCEPT;
+};
+
+template <typename C>
+constexpr bool next_format_segment( const C *&cursor, const C *end, size_t &nextIndex, format_segment<C> &segment ) UFMT_NOEXCEPT;
+
+template <bool Checked, typename W, typename C>
+size_t format_wrapped_args_to(
+    W &w,
+    const C *formatStr,
+    size_t formatStrLen,
+    const detail::wrapper *const argPtrs,
+    size_t numArgs );
+
+template <bool Checked, typename W, typename C, typename... Args>
+constexpr size_t format_typed_to( W &w, const C *formatStr, size_t formatStrLen, const Args &... args );
+
+template <typename T> constexpr bool is_char_v =
+    std::is_same_v<T, char> || std::is_same_v<T, wchar_t> || std::is_same_v<T, char16_t> || std::is_same_v<T, char32_t>
+#if defined(__cpp_char8_t)
+    || std::is_same_v<T, char8_t>
+#endif
+    ;
+
+/* Integer types formatted as numbers, std::is_integral_v does not cover __int128 in strict standard modes */
+template <typename T> constexpr bool is_integer_v =
+    std::is_integral_v<T> && !std::is_same_v<T, bool> && !is_char_v<T> && std::is_same_v<T, std::remove_cv_t<T>>;
+
+template <typename T> struct unsigned_of { using type = std::make_unsigned_t<T>; };
+
+#if defined(__SIZEOF_INT128__)
+// __extension__ keeps -Wpedantic quiet about the non-standard type
+__extension__ typedef __int128 int128_t;
+__extension__ typedef unsigned __int128 uint128_t;
+
+template <> constexpr bool is_integer_v<int128_t> = true;
+template <> constexpr bool is_integer_v<uint128_t> = true;
+
+template <> struct unsigned_of<int128_t> { using type = uint128_t; };
+template <> struct unsigned_of<uint128_t> { using type = uint128_t; };
+#endif
+
+template <typename T> using unsigned_of_t = typename unsigned_of<T>::type;
+
+template <typename T> constexpr bool is_string_v = false;
+template <size_t N, typename C> constexpr bool is_string_v<fixed_string<N, C>> = true;
+
+#if !defined(UFMT_DO_NOT_USE_STL)
+template <typename C, typename Tr, typename A> constexpr bool is_string_v<std::basic_string<C, Tr, A>> = true;
+template <typename C, typename Tr> constexpr bool is_string_v<std::basic_string_view<C, Tr>> = true;
+
+template <typename A> constexpr bool is_allocator_v = requires( A &alloc ) {
+	typename A::value_type;
+	alloc.deallocate( alloc.allocate( size_t( 1 ) ), size_t( 1 ) );
+};
+
+/* String of C whose storage comes from an allocator of any value type, e.g. std::pmr::polymorphic_allocator<> */
+template <typename C, typename A>
+using allocated_string = std::basic_string<C, std::char_traits<C>, typename std::allocator_traits<A>::template rebind_alloc<C>>;
+#endif
+
+template <typename T>
+constexpr const char *default_spec_types() noexcept
+{
+	if constexpr ( std::is_same_v<T, bool> )
+		return "s";
+	else if constexpr ( is_char_v<T> )
+		return "cbBdnoxX?jl";
+	else if constexpr ( is_integer_v<T> )
+		return "bBdnoxXaAeEfF";
+	else if constexpr ( std::is_floating_point_v<T> )
+		return "aAeEfFgGbBdnoxX";
+	else if constexpr ( std::is_pointer_v<T> )
+		return is_char_v<std::remove_cv_t<std::remove_pointer_t<T>>> ? "sjl?mMru" : "pP";
+	else if constexpr ( is_string_v<T> )
+		return "sjl?mMru";
+	else
+		return nullptr;
+}
+
+/* Not constexpr on purpose, reaching it during constant evaluation turns into a compile error */
+inline void format_error( const char *message ) { ( void )message; }
+
+} // namespace detail
+
+/* Presentation types accepted by a formatter, checked at compile time. nullptr leaves the spec unchecked. */
+template <typename T> struct format_spec_types
+{
+	static constexpr const char *value = detail::default_spec_types<T>();
+};
+
+namespace detail {
+
+/* `specTypes` holds the presentation types accepted by each argument, nullptr for unchecked ones */
+template <typename C>
+consteval void check_fields( const C *str, size_t len, const char *const *specTypes, size_t numArgs )
+{
+	bool *used = new bool[numArgs + 1] { };
+
+	// The segment scanner tolerates broken braces at runtime, reject them here
+	for ( size_t i = 0; i < len; ++i )
+	{
+		if ( str[i] == C( '{' ) )
+		{
+			if ( i + 1 < len && str[i + 1] == C( '{' ) )
+			{
+				++i;
+				continue;
+			}
+
+			while ( i < len && str[i] != C( '}' ) )
+				++i;
+
+			if ( i == len )
+				format_error( "unterminated replacement field" );
+		}
+		else if ( str[i] == C( '}' ) )
+		{
+			if ( i + 1 < len && str[i + 1] == C( '}' ) )
+				++i;
+			else
+				format_error( "unmatched '}' in format string" );
+		}
+	}
+
+	const C *cursor = str;
+	size_t nextIndex = 0;
+
+	format_segment<C> segment;
+	while ( next_format_segment( cursor, str + len, nextIndex, segment ) )
+	{
+		if ( segment.index == size_t( -1 ) )
+			continue;
+
+		if ( segment.index >= numArgs )
+			format_error( "argument index out of range" );
+
+		used[segment.index] = true;
+
+		if ( const char *types = specTypes[segment.index] )
+		{
+			if ( segment.spec_unparsed )
+				format_error( "invalid format spec" );
+
+			if ( segment.fd.type && !detail::find_char( types, char( segment.fd.type ) ) )
+				format_error( "presentation type not supported by argument" );
+		}
+	}
+
+	for ( size_t i = 0; i < numArgs; ++i )
+	{
+		if ( !used[i] )
+			format_error( "argument not used by format string" );
+	}
+
+	delete[] used;
+}
+
+template <typename C, typename... Args>
+consteval void check_format_string( const C *str, size_t len )
+{
+	constexpr const char *SpecTypes[] = { format_spec_types<std::decay_t<Args>>::value..., nullptr };
+	check_fields( str, len, SpecTypes, sizeof...( Args ) );
+}
+
+/* Type-erased formatting, the segment loop is instantiated once per writer rather than per argument list */
+template <bool Checked, typename W, typename C, typename... Args>
+inline size_t format_erased_to( W &w, const C *formatStr, size_t formatStrLen, Args &&... argPtrs )
+{
+	const detail::wrapper wrappedArgs[] { { &argPtrs, formatter<W, Args>::write }..., { } };
+#if defined(UFMT_STATS)
+	detail::stats_scope stats( formatStr, formatStrLen, w.length() );
+#endif
+	auto numChars = detail::format_wrapped_args_to<Checked>( w, formatStr, formatStrLen, wrappedArgs, sizeof...( Args ) );
+#if defined(UFMT_STATS)
+	stats.record( w.length(), w.overflow() );
+#endif
+	return numChars;
+}
+
+/* Longest output of one field, size_t( -1 ) when the type has no bound */
+template <typename C, typename T>
+constexpr size_t max_field_length( const format_desc &fd )
+{
+	if constexpr ( std::is_same_v<T, bool> )
+		return 5;
+	else if constexpr ( std::is_integral_v<T> || is_integer_v<T> )
+	{
+		if ( fd.type && detail::find_char( "aAeEfF", fd.type ) )
+			return max_field_length<C, double>( fd );
+
+		if ( is_char_v<T> && ( !fd.type || fd.type == 'c' ) )
+			return encoded_length<C>( 0x10FFFF );
+
+		if ( is_char_v<T> && fd.type == '?' )
+			return 12;
+
+		// A \uXXXX escape between quotes
+		if ( is_char_v<T> && ( fd.type == 'j' || fd.type == 'l' ) )
+			return 8;
+
+		// Digits of the largest magnitude, plus sign and base prefix
+		size_t numDigits = 1;
+		for ( auto value = unsigned_of_t<T>( -1 ); value >= unsigned( fd.base ); value /= unsigned( fd.base ) )
+			++numDigits;
+
+		// A separator of up to four bytes may follow every digit
+		return ( ( fd.type == 'n' ) ? 5 * numDigits : numDigits ) + 3;
+	}
+	else if constexpr ( std::is_floating_point_v<T> )
+	{
+		if ( fd.type && detail::find_char( "bBdoxX", fd.type ) )
+			return max_field_length<C, int64_t>( fd );
+
+		size_t precision = fd.precision ? size_t( fd.precision ) : 6;
+
+		// Sign, leading digit, point, exponent of up to three digits. Fixed notation is capped by write_float(),
+		// hex floats keep their 0x with the # flag and have a four digit exponent.
+		if ( fd.type == 'f' || fd.type == 'F' || fd.type == 'n' )
+		{
+			auto numChars = 3 + size_t( std::numeric_limits<T>::max_exponent10 ) + precision;
+			numChars = ( numChars < StackBufferLength ) ? numChars : StackBufferLength - 1;
+
+			// Grouping may add a separator of up to four bytes after every character
+			return ( fd.type == 'n' ) ? 5 * numChars : numChars;
+		}
+		else if ( fd.type == 'a' || fd.type == 'A' )
+			return 10 + ( fd.prefix ? 2 : 0 ) + ( fd.precision ? precision : 13 );
+
+		return 8 + precision;
+	}
+	else if constexpr ( std::is_array_v<T> && is_char_v<std::remove_cv_t<std::remove_extent_t<T>>> )
+	{
+		// A literal argument, transcoding takes at most four units per unit, escaping six (debug ten) plus quotes
+		constexpr size_t NumUnits = std::extent_v<T> - 1;
+		auto numChars = ( sizeof( C ) == sizeof( std::remove_extent_t<T> ) ) ? NumUnits : 4 * NumUnits;
+
+		if ( fd.type == '?' )
+			return 10 * NumUnits + 2;
+
+		// Encodings work on UTF-8, up to four bytes per unit of a wider string
+		if ( auto encoding = encoding_of( fd.type ); encoding != byte_encoding::none )
+			return encoded_size( encoding, ( sizeof( std::remove_extent_t<T> ) == 1 ) ? NumUnits : 4 * NumUnits );
+
+		return ( fd.type == 'j' || fd.type == 'l' ) ? 6 * numChars + 2 : numChars;
+	}
+	else if constexpr ( std::is_pointer_v<T> && !is_char_v<std::remove_cv_t<std::remove_pointer_t<T>>> )
+		return 2 + 2 * sizeof( void * );
+	else
+		return size_t( -1 );
+}
+
+/* Upper bound of the formatted length, size_t( -1 ) when an argument has none */
+template <typename C, typename... Args>
+consteval size_t max_formatted_length( const C *str, size_t len )
+{
+	check_format_string<C, Args...>( str, len );
+
+	constexpr size_t ( *FieldLength[] )( const format_desc & ) = { max_field_length<C, Args>..., nullptr };
+
+	const C *cursor = str;
+	size_t nextIndex = 0;
+	size_t result = 0;
+
+	format_segment<C> segment;
+	while ( next_format_segment( cursor, str + len, nextIndex, segment ) )
+	{
+		result += segment.literal_length;
+
+		if ( segment.index == size_t( -1 ) )
+			continue;
+
+		auto fieldLength = FieldLength[segment.index]( segment.fd );
+		if ( fieldLength == size_t( -1 ) )
+			return size_t( -1 );
+
+		// Padding counts code points, and a fill character may take several units
+		auto paddedLength = segment.fd.width * encoded_length<C>( char32_t( segment.fd.fill ) );
+		result += ( fieldLength > paddedLength ) ? fieldLength : paddedLength;
+	}
+
+	return result;
+}
+
+template <bool ZT, bool Checked, typename O, typename C, typename... Args>
+constexpr size_t format_to_( O &output, const C *formatStr, size_t formatStrLen, Args &&... argPtrs )
+{
+	detail::writer<O> w = { output };
+
+	// Constant evaluation cannot cast from void *, there each argument is formatted through its static type
+	auto numChars = std::is_constant_evaluated() ? detail::format_typed_to<Checked>( w, formatStr, formatStrLen, argPtrs... )
+	                                             : detail::format_erased_to<Checked>( w, formatStr, formatStrLen, argPtrs... );
+	if constexpr ( ZT ) { w.zero_terminate(); }
+	return numChars;
+}
+
+template <bool ZT, bool Checked, typename C, typename... Args>
+constexpr size_t format_to_n_( C *output, size_t outputLen, const C *formatStr, size_t formatStrLen, Args &&... argPtrs )
+{
+	detail::buffer_writer<C> w( output, outputLen );
+
+	auto numChars = std::is_constant_evaluated() ? detail::format_typed_to<Checked>( w, formatStr, formatStrLen, argPtrs... )
+	                                             : detail::format_erased_to<Checked>( w, formatStr, formatStrLen, argPtrs... );
+	if constexpr ( ZT ) { w.zero_terminate(); }
+	return numChars;
+}
+
+template <size_t N, bool Checked, typename C, typename... Args>
+constexpr fixed_string<N, C> format_fixed_( const C *formatStr, size_t formatStrLen, Args &&... argPtrs )
+{
+	fixed_string<N, C> result;
+
+	auto numChars = format_to_n_<false, Checked>( result.chars, N, formatStr, formatStrLen, argPtrs... );
+	result.count = ( numChars < N ) ? numChars : N;
+	result.overflowed = numChars > N;
+	return result;
+}
+
+} // namespace detail
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Format string that skips compile-time validation, see runtime() */
+template <typename C> struct runtime_format_string
+{
+	const C *str = nullptr;
+	size_t length = 0;
+};
+
+template <typename T>
+constexpr auto runtime( const T &formatStr ) noexcept
+{
+	using C = std::remove_cv_t<std::remove_pointer_t<decltype( data( formatStr ) )>>;
+	return runtime_format_string<C> { data( formatStr ), length( formatStr ) };
+}
+
+/* Format string literal validated against the argument types at compile time */
+template <typename C, typename... Args> struct basic_format_string
+{
+	const C *str = nullptr;
+	size_t length = 0;
+
+	template <size_t N>
+	consteval basic_format_string( const C ( &formatStr )[N] )
+		: str( formatStr )
+		, length( N - 1 )
+	{
+		detail::check_format_string<C, Args...>( str, length );
+	}
+
+#if !defined(UFMT_DO_NOT_USE_STL)
+	template <typename T>
+	requires std::is_convertible_v<const T &, std::basic_string_view<C>>
+	consteval basic_format_string( const T &formatStr )
+	{
+		std::basic_string_view<C> view = formatStr;
+		str = view.data();
+		length = view.length();
+		detail::check_format_string<C, Args...>( str, length );
+	}
+#endif
+};
+
+template <typename... Args> using format_string = basic_format_string<char, std::type_identity_t<Args>...>;
+template <typename... Args> using wformat_string = basic_format_string<wchar_t, std::type_identity_t<Args>...>;
+
+/*
+ * Formatting into arrays also works in constant expressions, for integers, bools, characters and strings:
+ *
+ *   constexpr auto Banner = [] { std::array<char, 32> s { }; ufmt::format_to( s, "v{}.{}", 2, 1 ); return s; }();
+ */
+template <typename O, typename... Args>
+constexpr size_t format_to( O &output, format_string<Args...> formatStr, Args &&... argPtrs )
+{
+	return detail::format_to_<false, true>( output, formatStr.str, formatStr.length, argPtrs... );
+}
+
+template <typename O, typename... Args>
+constexpr size_t format_to( O &output, wformat_string<Args...> formatStr, Args &&... argPtrs )
+{
+	return detail::format_to_<false, true>( output, formatStr.str, formatStr.length, argPtrs... );
+}
+
+template <typename O, typename C, typename... Args>
+constexpr size_t format_to( O &output, runtime_format_string<C> formatStr, Args &&... argPtrs )
+{
+	return detail::format_to_<false, false>( output, formatStr.str, formatStr.length, argPtrs... );
+}
+
+template <typename... Args>
+constexpr size_t format_to_n( char *output, size_t outputLen, format_string<Args...> formatStr, Args &&... argPtrs )
+{
+	return detail::format_to_n_<false, true>( output, outputLen, formatStr.str, formatStr.length, argPtrs... );
+}
+
+template <typename... Args>
+constexpr size_t format_to_n( wchar_t *output, size_t outputLen, wformat_string<Args...> formatStr, Args &&... argPtrs )
+{
+	return detail::format_to_n_<false, true>( output, outputLen, formatStr.str, formatStr.length, argPtrs... );
+}
+
+template <typename C, typename... Args>
+constexpr size_t format_to_n( C *output, size_t outputLen, runtime_format_string<C> formatStr, Args &&... argPtrs )
+{
+	return detail::format_to_n_<false, false>( output, outputLen, formatStr.str, formatStr.length, argPtrs... );
+}
+
+template <typename O, typename... Args>
+constexpr size_t format_to0( O &output, format_string<Args...> formatStr, Args &&... argPtrs )
+{
+	return detail::format_to_<true, true>( output, formatStr.str, formatStr.length, argPtrs... );
+}
+
+template <typename O, typename... Args>
+constexpr size_t format_to0( O &output, wformat_string<Args...> formatStr, Args &&... argPtrs )
+{
+	return detail::format_to_<true, true>( output, formatStr.str, formatStr.length, argPtrs... );
+}
+
+template <typename O, typename C, typename... Args>
+constexpr size_t format_to0( O &output, runtime_format_string<C> formatStr, Args &&... argPtrs )
+{
+	return detail::format_to_<true, false>( output, formatStr.str, formatStr.length, argPtrs... );
+}
+
+template <typename... Args>
+constexpr size_t format_to_n0( char *output, size_t outputLen, format_string<Args...> formatStr, Args &&... argPtrs )
+{
+	return detail::format_to_n_<true, true>( output, outputLen, formatStr.str, formatStr.length, argPtrs... );
+}
+
+template <typename... Args>
+constexpr size_t format_to_n0( wchar_t *output, size_t outputLen, wformat_string<Args...> formatStr, Args &&... argPtrs )
+{
+	return detail::format_to_n_<true, true>( output, outputLen, formatStr.str, formatStr.length, argPtrs... );
+}
+
+template <typename C, typename... Args>
+constexpr size_t format_to_n0( C *output, size_t outputLen, runtime_format_string<C> formatStr, Args &&... argPtrs )
+{
+	return detail::format_to_n_<true, false>( output, outputLen, formatStr.str, formatStr.length, argPtrs... );
+}
+
+#if !defined(UFMT_DO_NOT_USE_STL)
+template <typename C, typename... Args>
+std::basic_string<C> format( runtime_format_string<C> formatStr, Args &&... argPtrs )
+{
+	std::basic_string<C> result;
+	detail::format_to_<false, false>( result, formatStr.str, formatStr.length, argPtrs... );
+	return result;
+}
+
+template <typename... Args>
+std::string format( format_string<Args...> formatStr, Args &&... argPtrs )
+{
+	std::string result;
+	detail::format_to_<false, true>( result, formatStr.str, formatStr.length, argPtrs... );
+	return result;
+}
+
+template <typename... Args>
+std::wstring format( wformat_string<Args...> formatStr, Args &&... argPtrs )
+{
+	std::wstring result;
+	detail::format_to_<false, true>( result, formatStr.str, formatStr.length, argPtrs... );
+	return result;
+}
+
+/* Result storage comes from `alloc`, e.g. a std::pmr::polymorphic_allocator over a per-request arena */
+template <typename A, typename C, typename... Args>
+requires detail::is_allocator_v<A>
+detail::allocated_string<C, A> format( const A &alloc, runtime_format_string<C> formatStr, Args &&... argPtrs )
+{
+	detail::allocated_string<C, A> result( alloc );
+	detail::format_to_<false, false>( result, formatStr.str, formatStr.length, argPtrs... );
+	return result;
+}
+
+template <typename A, typename... Args>
+requires detail::is_allocator_v<A>
+detail::allocated_string<char, A> format( const A &alloc, format_string<Args...> formatStr, Args &&... argPtrs )
+{
+	detail::allocated_string<char, A> result( alloc );
+	detail::format_to_<false, true>( result, formatStr.str, formatStr.length, argPtrs... );
+	return result;
+}
+
+template <typename A, typename... Args>
+requires detail::is_allocator_v<A>
+detail::allocated_string<wchar_t, A> format( const A &alloc, wformat_string<Args...> formatStr, Args &&... argPtrs )
+{
+	detail::allocated_string<wchar_t, A> result( alloc );
+	detail::format_to_<false, true>( result, formatStr.str, formatStr.length, argPtrs... );
+	return result;
+}
+#endif
+
+/* Formats into an inline string of up to N characters, no heap. Longer output is cut and flagged as truncated(). */
+template <size_t N, typename... Args>
+constexpr fixed_string<N> format( format_string<Args...> formatStr, Args &&... argPtrs )
+{
+	return detail::format_fixed_<N, true>( formatStr.str, formatStr.length, argPtrs... );
+}
+
+template <size_t N, typename... Args>
+constexpr fixed_string<N, wchar_t> format( wformat_string<Args...> formatStr, Args &&... argPtrs )
+{
+	return detail::format_fixed_<N, true>( formatStr.str, formatStr.length, argPtrs... );
+}
+
+template <size_t N, typename C, typename... Args>
+constexpr fixed_string<N, C> format( runtime_format_string<C> formatStr, Args &&... argPtrs )
+{
+	return detail::format_fixed_<N, false>( formatStr.str, formatStr.length, argPtrs... );
+}
+
+/*
+ * Format string as a template argument, sized from it at compile time, e.g.:
+ *
+ *   auto line = ufmt::format<"{:>8} {:08x} {}">( id, hash, ok ); // fixed_string<29>
+ *
+ * Every argument needs a bounded length: integers, bools, characters, pointers and floats. The result can never
+ * be truncated, so formatting skips all bounds checks. Use format<N>() for strings and other unbounded types.
+ */
+template <fixed_string Format, typename... Args>
+constexpr auto format( Args &&... argPtrs )
+{
+	using C = typename decltype( Format )::value_type;
+
+	// Constant evaluation works on a copy, pointers into the template argument itself do not compare reliably there
+	constexpr auto MaxLength = []() consteval
+	{
+		auto formatStr = Format;
+		return detail::max_formatted_length<C, std::remove_cvref_t<Args>...>( formatStr.chars, formatStr.count );
+	}();
+
+	static_assert( MaxLength != size_t( -1 ), "argument without a bounded formatted length, use format<N>() instead" );
+
+	fixed_string<MaxLength, C> result;
+	detail::unchecked_writer<C> w( result.chars );
+
+	if ( std::is_constant_evaluated() )
+	{
+		auto formatStr = Format;
+		result.count = detail::format_typed_to<true>( w, formatStr.chars, formatStr.count, argPtrs... );
+	}
+	else
+		result.count = detail::format_erased_to<true>( w, Format.chars, Format.count, argPtrs... );
+
+	return result;
+}
+
+namespace detail {
+
+inline constexpr number_locale default_number_locale { };
+inline number_locale current_number_locale;
+
+constexpr const number_locale &active_number_locale() noexcept
+{
+	// Constant expressions cannot read the mutable global, they always get the default separators
+	if ( std::is_constant_evaluated() )
+		return default_number_locale;
+
+	return current_number_locale;
+}
+
+} // namespace detail
+
+/*
+ * Separators used by the 'n' presentation type from now on, e.g. "1.234.567,5" for German:
+ *
+ *   ufmt::set_number_locale( { ".", "," } );
+ *
+ * Not synchronized, like setlocale() it is meant to be called once before other threads start formatting.
+ */
+inline void set_number_locale( const number_locale &loc ) noexcept
+{
+	detail::current_number_locale = loc;
+}
+
+inline const number_locale &get_number_locale() noexcept
+{
+	return detail::current_number_locale;
+}
+
+} // namespace ufmt
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace ufmt::detail {
+
+enum class numeric_type
+{
+	signed_integer,
+	unsigned_integer,
+	floating_point
+};
+
+template <typename T>
+constexpr numeric_type integer_type_v = ( T( -1 ) < T( 0 ) ) ? numeric_type::signed_integer : numeric_type::unsigned_integer;
+
+/* Numbers align right by default, '0' fill pads between the sign or base prefix and the digits */
+template <typename W, typename C>
+constexpr bool append_numeric( W &w, const C *str, size_t prefixLen, size_t len, const format_desc &fd )
+{
+	if ( fd.width > len && fd.align == format_desc::alignment::none )
+	{
+		if ( fd.fill == '0' )
+		{
+			w.append( str, prefixLen );
+			w.append( "0", 1, fd.width - len );
+			return w.append( str + prefixLen, len - prefixLen );
+		}
+
+		w.append( " ", 1, fd.width - len );
+	}
+
+	return w.append( str, len );
+}
+
+template <typename W>
+inline bool write_float( W &w, double value, const format_desc &fd );
+
+/* printf output with its integer digits grouped and the decimal point replaced, in the one copy to the writer */
+template <typename W>
+inline bool append_grouped_float( W &w, const char *str, size_t prefixLen, const format_desc &fd )
+{
+	// The global itself, a reference bound to active_number_locale() would be constant-initialized to the default
+	const number_locale &loc = current_number_locale;
+	auto sepLen = separator_length( loc.thousands_sep );
+
+	const char *digits = str + prefixLen;
+	size_t numDigits = 0;
+	while ( is_digit( digits[numDigits] ) )
+		++numDigits;
+
+	// Every character may gain a separator of up to four bytes
+	char buff[StackBufferLength * 5];
+	auto *cursor = buff;
+
+	for ( size_t i = 0; i < prefixLen; ++i )
+		*cursor++ = str[i];
+
+	// Group sizes count from the decimal point, a separator goes where a group boundary falls
+	size_t groupSize = loc.group_size;
+	size_t nextGroupSize = loc.next_group_size ? loc.next_group_size : groupSize;
+
+	for ( size_t i = 0; i < numDigits; ++i )
+	{
+		if ( auto distance = numDigits - i; i && sepLen && groupSize && distance >= groupSize && ( distance - groupSize ) % nextGroupSize == 0 )
+			cursor = copy_ascii( loc.thousands_sep, sepLen, cursor );
+
+		*cursor++ = digits[i];
+	}
+
+	const char *rest = digits + numDigits;
+
+	if ( *rest == '.' )
+	{
+		cursor = copy_ascii( loc.decimal_point, separator_length( loc.decimal_point ), cursor );
+		++rest;
+	}
+
+	while ( *rest )
+		*cursor++ = *rest++;
+
+	return append_numeric( w, buff, prefixLen, size_t( cursor - buff ), fd );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/* The 'n' type, kept apart from write_integer() so the grouping loops do not weigh on plain decimal and hex fields */
+template <typename W, typename T>
+constexpr bool write_grouped_integer( W &w, T value, const format_desc &fd )
+{
+	using U = unsigned_of_t<T>;
+
+	// Decimal digits of the widest value, each may be followed by a separator of up to four bytes, and a sign
+	char buff[( sizeof( T ) * 8 * 30103 / 100000 + 1 ) * 5 + 1];
+	auto *end = buff + sizeof( buff );
+
+	auto magnitude = U( value );
+	bool negative = false;
+
+	if constexpr ( T( -1 ) < T( 0 ) )
+	{
+		if ( value < 0 )
+		{
+			magnitude = U( U( 0 ) - magnitude );
+			negative = true;
+		}
+	}
+
+	// Separators go in as each group of digits is produced
+	auto *begin = uint_to_dec_grouped( magnitude, end, active_number_locale() );
+	auto numDigits = size_t( end - begin );
+
+	if ( negative )
+		*--begin = '-';
+	else if ( fd.sign == '+' || fd.sign == ' ' )
+		*--begin = char( fd.sign );
+
+	auto len = size_t( end - begin );
+	return append_numeric( w, begin, len - numDigits, len, fd );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename W, typename T>
+constexpr bool write_integer( W &w, T value, const format_desc &fd )
+{
+	// A jump on the type instead of a scan of the float types
+	switch ( fd.type )
+	{
+		case 'a': case 'A': case 'e': case 'E': case 'f': case 'F':
+			return write_float( w, double( value ), fd );
+
+		case 'n':
+			return write_grouped_integer( w, value, fd );
+
+		default:
+			break;
+	}
+
+	using U = unsigned_of_t<T>;
+
+	// Binary digits of the widest value plus sign and base prefix
+	char buff[sizeof( T ) * 8 + 4];
+	auto *end = buff + sizeof( buff );
+
+	auto magnitude = U( value );
+	bool negative = false;
+
+	if constexpr ( T( -1 ) < T( 0 ) )
+	{
+		if ( value < 0 )
+		{
+			magnitude = U( U( 0 ) - magnitude );
+			negative = true;
+		}
+	}
+
+	bool upperCase = is_upper( fd.type );
+	auto *begin = uint_to_chars( magnitude, fd.base, upperCase, end );
+	auto numDigits = size_t( end - begin );
+
+	if ( fd.prefix && fd.base != 10 )
+	{
+		// Octal gets a single leading zero, and none when the digits already are one
+		if ( fd.base == 8 )
+		{
+			if ( magnitude )
+				*--begin = '0';
+		}
+		else
+		{
+			*--begin = ( fd.base == 16 ) ? ( upperCase ? 'X' : 'x' ) : ( upperCase ? 'B' : 'b' );
+			*--begin = '0';
+		}
+	}
+
+	if ( negative )
+		*--begin = '-';
+	else if ( fd.sign == '+' || fd.sign == ' ' )
+		*--begin = char( fd.sign );
+
+	auto len = size_t( end - begin );
+	return append_numeric( w, begin, len - numDigits, len, fd );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename W>
+inline bool write_float( W &w, double value, const format_desc &fd )
+{
+	if ( fd.type && detail::find_char( "bBdoxX", fd.type ) )
+		return write_integer( w, int64_t( value ), fd );
+
+	char buff[StackBufferLength] = { };
+	char *prefixCursor = buff;
+
+	if ( value > 0 )
+	{
+		if ( fd.sign == '+' || fd.sign == ' ' )
+			*prefixCursor++ = char( fd.sign );
+	}
+	else if ( value < 0 )
+	{
+		*prefixCursor++ = '-';
+		value = -value;
+	}
+
+	// Shortest of fixed and exponent notation when no type is given, 'n' is fixed notation with separators
+	char type = !fd.type ? 'g' : ( fd.type == 'n' ) ? 'f' : char( fd.type );
+	char fmtBuff[StackBufferLength] = { '%' };
+
+	if ( fd.precision > 0 )
+	{
+		fmtBuff[1] = '.';
+		fmtBuff[2] = '*';
+		fmtBuff[3] = type;
+		fmtBuff[4] = 0;
+
+		snprintf( prefixCursor, detail::StackBufferLength - ( prefixCursor - buff ), fmtBuff, fd.precision, value );
+	}
+	else
+	{
+		fmtBuff[1] = type;
+		fmtBuff[2] = 0;
+
+		snprintf( prefixCursor, detail::StackBufferLength - ( prefixCursor - buff ), fmtBuff, value );
+	}
+
+	if ( ( type == 'a' || type == 'A' ) && !fd.prefix )
+	{
+		auto *c = prefixCursor;
+		while ( c[1] )
+		{
+			*c = c[2];
+			++c;
+		}
+	}
+
+	if ( is_upper( type ) )
+	{
+		auto *c = buff;
+		while ( *c )
+		{
+			*c = char( toupper( *c ) );
+			++c;
+		}
+	}
+
+	if ( fd.type == 'n' )
+		return append_grouped_float( w, buff, size_t( prefixCursor - buff ), fd );
+
+	return append_numeric( w, buff, size_t( prefixCursor - buff ), length( buff ), fd );
+}
+
+template <typename W, typename T, numeric_type Type> struct numeric_formatter
+{
+	static bool write( void *writerPtr, const void *valuePtr, const format_desc &fd )
+	{
+		W &w = *reinterpret_cast<W *>( writerPtr );
+		auto value = *reinterpret_cast<const T *>( valuePtr );
+
+		if constexpr ( Type == numeric_type::floating_point )
+			return write_float( w, value, fd );
+		else
+			return write_integer( w, value, fd );
+	}
+};
+
+template <typename W, typename C> struct char_formatter
+{
+	static bool write( void *writerPtr, const void *valuePtr, const format_desc &fd )
+	{
+		W &w = *reinterpret_cast<W *>( writerPtr );
+		C value = *reinterpret_cast<const C *>( valuePtr );
+
+		if ( fd.type && detail::find_char( "bBdnoxX", fd.type ) )
+			return write_integer( w, value, fd );
+
+		if ( fd.type == '?' )
+			return write_debug( w, &value, 1, '\'' );
+
+		// A one character string to the JSON and logfmt escapers
+		if ( fd.type == 'j' || fd.type == 'l' )
+			return write_string( w, &value, 1, fd.type );
+
+		return w.append( &value, 1 );
+	}
+};
+
+/* Quoted string with JSON escapes, the output stays valid UTF-8 / UTF-16 */
+template <typename W, typename C>
+constexpr bool write_quoted( W &w, const C *str, size_t len )
+{
+	w.append( "\"", 1 );
+
+	for ( size_t pos = 0; pos < len; )
+	{
+		// Clean runs go out in one piece
+		auto runLen = find_escape<escape_mode::json>( str + pos, len - pos );
+		if ( runLen )
+		{
+			w.append( str + pos, runLen );
+			pos += runLen;
+
+			if ( pos == len )
+				break;
+		}
+
+		auto unit = uint32_t( std::make_unsigned_t<C>( str[pos++] ) );
+		char escape[6] = { '\\', char( unit ) };
+		size_t escapeLen = 2;
+
+		switch ( unit )
+		{
+			case '\b': escape[1] = 'b'; break;
+			case '\f': escape[1] = 'f'; break;
+			case '\n': escape[1] = 'n'; break;
+			case '\r': escape[1] = 'r'; break;
+			case '\t': escape[1] = 't'; break;
+			case '"': case '\\': break;
+
+			default:
+				escape[1] = 'u';
+				escape[2] = '0';
+				escape[3] = '0';
+				escape[4] = "0123456789abcdef"[unit >> 4];
+				escape[5] = "0123456789abcdef"[unit & 15];
+				escapeLen = 6;
+				break;
+		}
+
+		w.append( escape, escapeLen );
+	}
+
+	return w.append( "\"", 1 );
+}
+
+/*
+ * Debug representation like C++23 '?': quoted, printable text as-is, \t \n \r \\ and the quote escaped, other control
+ * characters as \u{..}, units that do not form a valid code point as \x{..}. Characters quote with '\''.
+ */
+template <typename W, typename C>
+constexpr bool write_debug( W &w, const C *str, size_t len, char quote )
+{
+	w.append( &quote, 1 );
+
+	const C *end = str + len;
+	const C *run = str;
+
+	auto appendEscape = [&]( char kind, uint32_t value )
+	{
+		char escape[16];
+		auto *escapeEnd = escape + sizeof( escape );
 
-		const auto &value = *reinterpret_cast<const T *>( valuePtr );
-		return w.append( data( value ), length( value ) );
-	}
-};
+		*--escapeEnd = '}';
+		escapeEnd = uint_to_chars( value, 16, false, escapeEnd );
+		*--escapeEnd = '{';
+		*--escapeEnd = kind;
+		*--escapeEnd = '\\';
 
-template <typename W, typename T> struct formatter<W, T &>
-{
-	static bool write( void *writerPtr, const void *valuePtr, const format_desc &fd )
+		w.append( escapeEnd, size_t( escape + sizeof( escape ) - escapeEnd ) );
+	};
+
+	for ( const C *cursor = str; cursor < end; )
 	{
-		return formatter<W, T>::write( writerPtr, valuePtr, fd );
-	}
-};
+		// A character has nothing to scan ahead, it goes unit by unit
+		if ( quote == '"' )
+		{
+			cursor += find_escape<escape_mode::debug>( cursor, size_t( end - cursor ) );
+			if ( cursor == end )
+				break;
+		}
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		auto unit = uint32_t( std::make_unsigned_t<C>( *cursor ) );
+		const C *next = cursor + 1;
 
-namespace detail {
+		if constexpr ( sizeof( C ) == 1 )
+		{
+			// Two byte sequences above the C1 controls, e.g. accented Latin, stay in the run without a full decode
+			if ( unit >= 0xC2 && unit <= 0xDF && next < end && is_trailing_unit( *next ) && ( unit > 0xC2 || uint8_t( *next ) >= 0xA0 ) )
+			{
+				cursor += 2;
+				continue;
+			}
+		}
 
-using formatter_write_func = bool( * )( void *writerPtr, const void *valuePtr, const format_desc &fd );
+		if ( unit >= 0x80 )
+		{
+			next = cursor;
+			auto cp = decode_utf( next, end );
 
-struct wrapper
-{
-	const void *ptr = nullptr;
-	formatter_write_func writeFunc = nullptr;
-};
+			// U+FFFD also stands for a decoding error, only a real one starts with its own lead unit
+			bool valid = ( cp != 0xFFFD ) || ( unit == ( ( sizeof( C ) == 1 ) ? 0xEFu : 0xFFFDu ) );
 
-template <typename W, typename C>
-size_t format_wrapped_args_to(
-    W &w,
-    const C *formatStr,
-    size_t formatStrLen,
-    const detail::wrapper *const argPtrs,
-    size_t numArgs );
+			// Printable text stays in the run, only C1 controls and invalid units break it
+			if ( valid && cp >= 0xA0 )
+			{
+				cursor = next;
+				continue;
+			}
 
-template <bool ZT, typename O, typename C, size_t N, typename... Args>
-size_t format_to_( O &output, const C( &formatStr )[N], Args &&... argPtrs )
-{
-	detail::writer<O> w = { output };
-	const detail::wrapper wrappedArgs[] { { &argPtrs, formatter<decltype( w ), Args>::write }..., { } };
-	auto numChars = detail::format_wrapped_args_to( w, formatStr, N - 1, wrappedArgs, sizeof...( Args ) );
-	if constexpr ( ZT ) { w.zero_terminate(); }
-	return numChars;
-}
+			w.append( run, size_t( cursor - run ) );
 
-template <bool ZT, typename O, typename T, typename... Args>
-size_t format_to_( O &output, T formatStr, Args &&... argPtrs )
-{
-	detail::writer<O> w = { output };
-	const detail::wrapper wrappedArgs[] { { &argPtrs, formatter<decltype( w ), Args>::write }..., { } };
-	auto numChars = detail::format_wrapped_args_to( w, data( formatStr ), length( formatStr ), wrappedArgs, sizeof...( Args ) );
-	if constexpr ( ZT ) { w.zero_terminate(); }
-	return numChars;
-}
+			if ( valid )
+				appendEscape( 'u', uint32_t( cp ) );
+			else
+			{
+				for ( const C *p = cursor; p < next; ++p )
+					appendEscape( 'x', uint32_t( std::make_unsigned_t<C>( *p ) ) );
+			}
+		}
+		else
+		{
+			if ( unit >= 0x20 && unit < 0x7F && unit != '\\' && unit != uint32_t( quote ) )
+			{
+				cursor = next;
+				continue;
+			}
 
-template <bool ZT, typename C, typename T, typename... Args>
-size_t format_to_n_( C *output, size_t outputLen, T formatStr, Args &&... argPtrs )
-{
-	detail::buffer_writer<C> w( output, outputLen );
-	const detail::wrapper wrappedArgs[] { { &argPtrs, formatter<decltype( w ), Args>::write }..., { } };
-	auto numChars = detail::format_wrapped_args_to( w, data( formatStr ), length( formatStr ), wrappedArgs, sizeof...( Args ) );
-	if constexpr ( ZT ) { w.zero_terminate(); }
-	return numChars;
-}
+			w.append( run, size_t( cursor - run ) );
 
-} // namespace detail
+			char escape[2] = { '\\', char( unit ) };
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+			switch ( unit )
+			{
+				case '\t': escape[1] = 't'; break;
+				case '\n': escape[1] = 'n'; break;
+				case '\r': escape[1] = 'r'; break;
+				case '"': case '\'': case '\\': break;
+				default: escape[1] = 0; break;
+			}
 
-template <typename O, typename C, size_t N, typename... Args>
-size_t format_to( O &output, const C ( &formatStr )[N], Args &&... argPtrs )
-{
-	return detail::format_to_<false>( output, formatStr, argPtrs... );
-}
+			if ( escape[1] )
+				w.append( escape, 2 );
+			else
+				appendEscape( 'u', unit );
+		}
 
-template <typename O, typename T, typename... Args>
-size_t format_to( O &output, T formatStr, Args &&... argPtrs )
-{
-	return detail::format_to_<false>( output, formatStr, argPtrs... );
-}
+		run = cursor = next;
+	}
 
-template <typename C, typename T, typename... Args>
-size_t format_to_n( C *output, size_t outputLen, T formatStr, Args &&... argPtrs )
-{
-	return detail::format_to_n_<false>( output, outputLen, formatStr, argPtrs... );
+	w.append( run, size_t( end - run ) );
+	return w.append( &quote, 1 );
 }
 
-template <typename O, typename C, size_t N, typename... Args>
-size_t format_to0( O &output, const C( &formatStr )[N], Args &&... argPtrs )
+/*
+ * String argument, escaped or encoded when the presentation type asks for it: 'j' JSON string, 'l' logfmt value,
+ * '?' debug, 'm' base64, 'M' base64url, 'r' base32, 'u' percent-encoded
+ */
+template <typename W, typename C>
+constexpr bool write_string( W &w, const C *str, size_t len, int type )
 {
-	return detail::format_to_<true>( output, formatStr, argPtrs... );
-}
+	if ( type == 'j' )
+		return write_quoted( w, str, len );
 
-template <typename O, typename T, typename... Args>
-size_t format_to0( O &output, T formatStr, Args &&... argPtrs )
-{
-	return detail::format_to_<true>( output, formatStr, argPtrs... );
-}
+	if ( type == '?' )
+		return write_debug( w, str, len, '"' );
 
-template <typename C, typename T, typename... Args>
-size_t format_to_n0( C *output, size_t outputLen, T formatStr, Args &&... argPtrs )
-{
-	return detail::format_to_n_<true>( output, outputLen, formatStr, argPtrs... );
-}
+	if ( auto encoding = encoding_of( type ); encoding != byte_encoding::none )
+		return write_encoded( w, str, len, encoding );
 
-#if !defined(UFMT_DO_NOT_USE_STL)
-template <typename C, typename... Args>
-std::basic_string<C> format( std::basic_string_view<C> formatStr, Args &&... argPtrs )
-{
-	std::basic_string<C> result;
-	format_to( result, formatStr, argPtrs... );
-	return result;
-}
+	// logfmt quotes only values that would not parse back bare
+	if ( type == 'l' && ( !len || find_escape<escape_mode::logfmt>( str, len ) < len ) )
+		return write_quoted( w, str, len );
 
-template <typename... Args>
-std::string format( std::string_view formatStr, Args &&... argPtrs )
-{
-	return format<char>( formatStr, argPtrs... );
+	return w.append( str, len );
 }
 
-template <typename... Args>
-std::wstring format( std::wstring_view formatStr, Args &&... argPtrs )
+/* Zero terminated string of any character type, transcoded by the writer when it differs from the output */
+template <typename W, typename C> struct cstring_formatter
 {
-	return format<wchar_t>( formatStr, argPtrs... );
-}
-#endif
-
-} // namespace ufmt
+	static bool write( void *writerPtr, const void *valuePtr, const format_desc &fd )
+	{
+		const C *value = *reinterpret_cast<const C *const *>( valuePtr );
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		W &w = *reinterpret_cast<W *>( writerPtr );
 
-namespace ufmt::detail {
+		if ( !value )
+			return w.append( ( fd.type == 'j' ) ? "null" : "nullptr" );
 
-enum class numeric_type
-{
-	signed_integer,
-	unsigned_integer,
-	floating_point
+		return write_string( w, value, length( value ), fd.type );
+	}
 };
 
-template <typename W, typename T, numeric_type Type> struct numeric_formatter
+/* Formatters above for a statically known type, usable in constant expressions */
+template <typename W, typename T>
+constexpr bool format_value( W &w, const T &value, const format_desc &fd )
 {
-	static bool write( void *writerPtr, const void *valuePtr, const format_desc &fd )
+	using V = std::remove_cv_t<T>;
+
+	if constexpr ( std::is_same_v<V, bool> )
+		return w.append( value ? "true" : "false" );
+	else if constexpr ( is_char_v<V> )
 	{
-		W &w = *reinterpret_cast<W *>( writerPtr );
+		if ( fd.type && detail::find_char( "bBdnoxX", fd.type ) )
+			return write_integer( w, value, fd );
 
-		auto value = *reinterpret_cast<const T *>( valuePtr );
+		if ( fd.type == 'j' || fd.type == 'l' )
+			return write_string( w, &value, 1, fd.type );
 
-		if constexpr ( Type == numeric_type::floating_point )
+		return ( fd.type == '?' ) ? write_debug( w, &value, 1, '\'' ) : w.append( &value, 1 );
+	}
+	else if constexpr ( is_integer_v<V> )
+		return write_integer( w, value, fd );
+	else if constexpr ( std::is_array_v<V> && is_char_v<std::remove_cv_t<std::remove_extent_t<V>>> )
+		return write_string( w, value, std::extent_v<V> - 1, fd.type );
+	else if constexpr ( std::is_pointer_v<V> && is_char_v<std::remove_cv_t<std::remove_pointer_t<V>>> )
+		return value ? write_string( w, value, length( value ), fd.type ) : w.append( ( fd.type == 'j' ) ? "null" : "nullptr" );
+	else if constexpr ( is_string_v<V> )
+		return write_string( w, value.data(), value.size(), fd.type );
+	else
+		return format_error( "argument type cannot be formatted in a constant expression" ), false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename C>
+constexpr bool next_format_segment( const C *&cursor, const C *end, size_t &nextIndex, format_segment<C> &segment ) UFMT_NOEXCEPT
+{
+	if ( cursor >= end )
+		return false;
+
+	segment.literal = cursor;
+	segment.literal_length = 0;
+	segment.index = size_t( -1 );
+
+	while ( cursor < end )
+	{
+		auto ch = *cursor;
+
+		if ( ch == C( '{' ) )
 		{
-			if ( fd.type && detail::find_char( "bBdoxXn", fd.type ) )
+			segment.literal_length = size_t( cursor - segment.literal );
+
+			// Escaped '{{', keep the first brace as part of the literal run
+			if ( cursor + 1 < end && cursor[1] == C( '{' ) )
 			{
-				auto valueInt64 = int64_t( value );
-				return numeric_formatter<W, int64_t, numeric_type::signed_integer>::write( writerPtr, &valueInt64, fd );
+				++segment.literal_length;
+				cursor += 2;
+				return true;
 			}
-		}
-		else
-		{
-			if ( fd.type && detail::find_char( "aAeEfF", fd.type ) )
+
+			// The first ':' is found in the same scan as the closing brace
+			const auto *fieldBegin = ++cursor;
+			const C *spec = nullptr;
+
+			for ( ; cursor < end && ( *cursor ) != C( '}' ); ++cursor )
 			{
-				auto valueDouble = double( value );
-				return numeric_formatter<W, double, numeric_type::floating_point>::write( writerPtr, &valueDouble, fd );
+				if ( !spec && ( *cursor ) == C( ':' ) )
+					spec = cursor;
 			}
-		}
 
-		char buff[StackBufferLength] = { };
-		char *prefixCursor = buff;
+			// Unterminated replacement field is dropped
+			if ( cursor == end )
+				return true;
 
-		if ( value > 0 )
-		{
-			if ( fd.sign == '+' || fd.sign == ' ' )
-				*prefixCursor++ = fd.sign;
-		}
-		else if ( value < 0 && ( fd.base != 10 || Type == numeric_type::floating_point ) )
-		{
-			if constexpr ( Type != numeric_type::unsigned_integer )
+			const auto *fieldEnd = cursor++;
+			if ( !spec )
+				spec = fieldEnd;
+
+			if ( spec > fieldBegin && detail::is_digit( *fieldBegin ) )
 			{
-				*prefixCursor++ = '-';
-				value = -value;
+				size_t numCharsLeft = size_t( spec - fieldBegin );
+				nextIndex = detail::string_to_uint( fieldBegin, numCharsLeft );
 			}
-		}
 
-		char prefixChar = 0;
+			if ( spec < fieldEnd )
+				++spec;
 
-		if constexpr ( Type == numeric_type::floating_point )
-		{
-			// TBD
+			segment.index = nextIndex++;
+			segment.fd = format_desc::parse( spec, size_t( fieldEnd - spec ), &segment.spec_unparsed );
+			return true;
 		}
-		else
+		else if ( ch == C( '}' ) )
 		{
-			if ( fd.prefix )
-				prefixChar = fd.type;
-		}
+			segment.literal_length = size_t( cursor - segment.literal );
 
-		if ( prefixChar )
-		{
-			*prefixCursor++ = '0';
-			*prefixCursor++ = fd.type;
-		}
+			// Escaped '}}' emits a single brace, a lone '}' is skipped
+			if ( cursor + 1 < end && cursor[1] == C( '}' ) )
+			{
+				++segment.literal_length;
+				++cursor;
+			}
 
-		if constexpr ( Type == numeric_type::signed_integer )
-		{
-			if constexpr ( sizeof( T ) <= 4 )
-#if defined(_MSC_VER)
-				_itoa( int( value ), prefixCursor, fd.base );
-#else
-				snprintf( prefixCursor, detail::StackBufferLength - ( prefixCursor - buff ), "%" PRIi32, int32_t( value ) );
-#endif
-			else if constexpr ( sizeof( T ) == 8 )
-#if defined(_MSC_VER)
-				_i64toa( int64_t( value ), prefixCursor, fd.base );
-#else
-				snprintf( prefixCursor, detail::StackBufferLength - ( prefixCursor - buff ), "%" PRIi64, int64_t( value ) );
-#endif
-		}
-		else if constexpr ( Type == numeric_type::unsigned_integer )
-		{
-			if constexpr ( sizeof( T ) <= 4 )
-#if defined(_MSC_VER)
-				_ultoa( uint( value ), prefixCursor, fd.base );
-#else
-				snprintf( prefixCursor, detail::StackBufferLength - ( prefixCursor - buff ), "%" PRIu32, uint32_t( value ) );
-#endif
-			else if constexpr ( sizeof( T ) == 8 )
-#if defined(_MSC_VER)
-				_ui64toa( uint64_t( value ), prefixCursor, fd.base );
-#else
-				snprintf( prefixCursor, detail::StackBufferLength - ( prefixCursor - buff ), "%" PRIu64, uint64_t( value ) );
-#endif
+			++cursor;
+			return true;
 		}
-		else if constexpr ( Type == numeric_type::floating_point )
-		{
-			char fmtBuff[StackBufferLength] = { '%' };
 
-			if ( fd.precision > 0 )
-			{
-				fmtBuff[1] = '.';
-				fmtBuff[2] = '*';
-				fmtBuff[3] = fd.type;
-				fmtBuff[4] = 0;
+		++cursor;
+	}
 
-				snprintf( prefixCursor, detail::StackBufferLength - ( prefixCursor - buff ), fmtBuff, fd.precision, value );
-			}
-			else
-			{
-				fmtBuff[1] = fd.type;
-				fmtBuff[2] = 0;
+	segment.literal_length = size_t( cursor - segment.literal );
+	return true;
+}
 
-				snprintf( prefixCursor, detail::StackBufferLength - ( prefixCursor - buff ), fmtBuff, value );
-			}
+//---------------------------------------------------------------------------------------------------------------------
+template <typename W, typename C>
+constexpr void append_literal( W &w, const C *str, size_t len )
+{
+	// Writers that can reference format string text in place get it uncopied
+	if constexpr ( requires { w.append_literal( str, len ); } )
+		w.append_literal( str, len );
+	else
+		w.append( str, len );
+}
 
-			if ( ( fd.type == 'a' || fd.type == 'A' ) && !fd.prefix )
-			{
-				auto *c = prefixCursor;
-				while ( c[1] )
-				{
-					*c = c[2];
-					++c;
-				}
-			}
-		}
+//---------------------------------------------------------------------------------------------------------------------
+template <typename W>
+constexpr void align_formatted( W &w, size_t prevLen, const format_desc &fd )
+{
+	// Width counts code points, not code units. Skip the count for unpadded fields, it rescans the whole field
+	if ( !fd.width )
+		return;
 
-		if ( is_upper( fd.type ) )
+	if ( auto len = w.code_points( prevLen ); len < fd.width )
+	{
+		auto padLen = fd.width - len;
+
+		// Anything not aligned by its own formatter, as numbers are, goes left
+		if ( fd.align == format_desc::alignment::left || fd.align == format_desc::alignment::none )
+			w.append( &fd.fill, 1, padLen );
+		else if ( fd.align == format_desc::alignment::right )
+			w.insert( prevLen, &fd.fill, 1, padLen );
+		else if ( fd.align == format_desc::alignment::center )
 		{
-			auto *c = buff;
-			while ( *c )
-			{
-				*c = toupper( *c );
-				++c;
-			}
+			padLen /= 2;
+
+			w.insert( prevLen, &fd.fill, 1, padLen );
+			w.append( &fd.fill, 1, padLen );
+
+			if ( len + 2 * padLen < fd.width )
+				w.append( &fd.fill, 1 );
 		}
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename C, size_t MaxSegments>
+constexpr parsed_format<C, MaxSegments>::parsed_format( const C *formatStr, size_t formatStrLen ) UFMT_NOEXCEPT
+{
+	if ( !formatStr )
+		return;
+
+	const auto *formatEnd = formatStr + formatStrLen;
+	size_t nextIndex = 0;
 
-		if ( auto len = length( buff ); len < fd.width )
+	format_segment<C> segment;
+	while ( num_segments < MaxSegments && next_format_segment( formatStr, formatEnd, nextIndex, segment ) )
+	{
+		// Attach a field directly following an escaped brace to the preceding literal run
+		if ( num_segments && segments[num_segments - 1].index == size_t( -1 ) && !segment.literal_length )
 		{
-			w.append( buff, prefixCursor - buff );
-			w.append( "0", 1, fd.width - len );
-			return w.append( prefixCursor );
+			segments[num_segments - 1].index = segment.index;
+			segments[num_segments - 1].fd = segment.fd;
+			continue;
 		}
 
-		return w.append( buff );
+		segments[num_segments++] = segment;
+
+		if ( segment.index != size_t( -1 ) && segment.index >= num_args )
+			num_args = segment.index + 1;
 	}
-};
+
+	if ( formatStr < formatEnd )
+		overflow = true;
+}
 
 //---------------------------------------------------------------------------------------------------------------------
-template <typename W, typename C>
+template <bool Checked, typename W, typename C>
 inline size_t format_wrapped_args_to(
     W &w,
     const C *formatStr,
@@ -334,108 +1379,62 @@ inline size_t format_wrapped_args_to(
     const detail::wrapper *const argPtrs,
     size_t numArgs )
 {
-	// Early out
-	if ( formatStr == nullptr || *formatStr == 0 )
-		return 0;
-
-	C valuePtrBuff[StackBufferLength] = { };
-	size_t valuePtrLength = 0;
-	size_t valuePtrIndex = 0;
+	// Early out, a checked format string is never null
+	if constexpr ( !Checked )
+	{
+		if ( formatStr == nullptr || *formatStr == 0 )
+			return 0;
+	}
 
-	bool parsingFormat = false;
-	C prevCh = 0;
+	const auto *formatEnd = formatStr + formatStrLen;
+	size_t nextIndex = 0;
 
-	while ( formatStrLen-- )
+	format_segment<C> segment;
+	while ( next_format_segment( formatStr, formatEnd, nextIndex, segment ) )
 	{
-		auto ch = *formatStr++;
-		bool append = !parsingFormat;
+		if ( segment.literal_length )
+			append_literal( w, segment.literal, segment.literal_length );
 
-		if ( parsingFormat )
+		// Checked format strings reference valid arguments only
+		if ( Checked ? ( segment.index != size_t( -1 ) ) : ( segment.index < numArgs ) )
 		{
-			if ( ch == C( '}' ) )
-			{
-				parsingFormat = false;
-				prevCh = 0;
-				append = false;
-				valuePtrBuff[valuePtrLength] = 0;
-
-				auto *valuePtrFormat = valuePtrBuff;
-
-				if ( valuePtrLength )
-				{
-					for ( size_t i = 0; i < valuePtrLength && ( *valuePtrFormat ) != C( ':' ); ++i )
-						++valuePtrFormat;
-
-					if ( valuePtrFormat < valuePtrBuff + valuePtrLength )
-					{
-						*valuePtrFormat = 0;
-						++valuePtrFormat;
-					}
-
-					if ( detail::is_digit( valuePtrBuff[0] ) )
-						valuePtrIndex = detail::string_to_int( valuePtrBuff );
-				}
-
-				if ( valuePtrIndex < numArgs )
-				{
-					format_desc fd = format_desc::parse( valuePtrFormat, argPtrs, numArgs, valuePtrIndex );
-
-					auto prevLen = w.length();
-					argPtrs[valuePtrIndex].writeFunc( &w, argPtrs[valuePtrIndex].ptr, fd );
-
-					if ( auto len = w.length() - prevLen; len < fd.width )
-					{
-						auto padLen = fd.width - len;
-
-						if ( fd.align == format_desc::alignment::left )
-							w.append( &fd.fill, 1, padLen );
-						else if ( fd.align == format_desc::alignment::right )
-							w.insert( prevLen, &fd.fill, 1, padLen );
-						else if ( fd.align == format_desc::alignment::center )
-						{
-							padLen /= 2;
-
-							w.insert( prevLen, &fd.fill, 1, padLen );
-							w.append( &fd.fill, 1, padLen );
-
-							if ( len + 2 * padLen < fd.width )
-								w.append( &fd.fill, 1 );
-						}
-					}
-				}
-
-				++valuePtrIndex;
-			}
-			else if ( ch == C( '{' ) )
-			{
-				parsingFormat = false;
-				prevCh = 0;
-				append = true;
-			}
-			else
-			{
-				if ( valuePtrLength < StackBufferLength - 1 )
-					valuePtrBuff[valuePtrLength++] = ch;
-			}
+			auto prevLen = w.length();
+			argPtrs[segment.index].writeFunc( &w, argPtrs[segment.index].ptr, segment.fd );
+			align_formatted( w, prevLen, segment.fd );
 		}
-		else
-		{
-			if ( ch == C( '{' ) )
-			{
-				parsingFormat = true;
-				prevCh = 0;
-				append = false;
+	}
 
-				valuePtrLength = 0;
-			}
-			else if ( ch == C( '}' ) )
-				append = ( prevCh == C( '}' ) );
-		}
+	return w.length();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <bool Checked, typename W, typename C, typename... Args>
+constexpr size_t format_typed_to( W &w, const C *formatStr, size_t formatStrLen, const Args &... args )
+{
+	if constexpr ( !Checked )
+	{
+		if ( formatStr == nullptr || *formatStr == 0 )
+			return 0;
+	}
+
+	const auto *formatEnd = formatStr + formatStrLen;
+	size_t nextIndex = 0;
+
+	format_segment<C> segment;
+	while ( next_format_segment( formatStr, formatEnd, nextIndex, segment ) )
+	{
+		if ( segment.literal_length )
+			append_literal( w, segment.literal, segment.literal_length );
+
+		if ( segment.index < sizeof...( Args ) )
+		{
+			auto prevLen = w.length();
 
-		if ( append )
-			w.append( &ch, 1 );
+			size_t index = 0;
+			( ( index++ == segment.index && format_value( w, args, segment.fd ) ), ... );
 
-		prevCh = ch;
+			align_formatted( w, prevLen, segment.fd );
+		}
 	}
 
 	return w.length();
@@ -447,14 +1446,10 @@ inline size_t format_wrapped_args_to(
 
 namespace ufmt {
 
-template <typename W> struct formatter<W, int16_t> : detail::numeric_formatter<W, int16_t, detail::numeric_type::signed_integer> { };
-template <typename W> struct formatter<W, int32_t> : detail::numeric_formatter<W, int32_t, detail::numeric_type::signed_integer> { };
-template <typename W> struct formatter<W, int64_t> : detail::numeric_formatter<W, int64_t, detail::numeric_type::signed_integer> { };
-
-template <typename W> struct formatter<W, uint8_t > : detail::numeric_formatter<W, uint8_t,  detail::numeric_type::unsigned_integer> { };
-template <typename W> struct formatter<W, uint16_t> : detail::numeric_formatter<W, uint16_t, detail::numeric_type::unsigned_integer> { };
-template <typename W> struct formatter<W, uint32_t> : detail::numeric_formatter<W, uint32_t, detail::numeric_type::unsigned_integer> { };
-template <typename W> struct formatter<W, uint64_t> : detail::numeric_formatter<W, uint64_t, detail::numeric_type::unsigned_integer> { };
+/* Every integer width, including int8_t, long and long long as distinct types, and __int128 where available */
+template <typename W, typename T>
+requires detail::is_integer_v<T>
+struct formatter<W, T> : detail::numeric_formatter<W, T, detail::integer_type_v<T>> { };
 
 template <typename W> struct formatter<W, double> : detail::numeric_formatter<W, double, detail::numeric_type::floating_point> { };
 
@@ -478,39 +1473,33 @@ template <typename W> struct formatter<W, float>
 	}
 };
 
-template <typename W> struct formatter<W, char>
-{
-	static bool write( void *writerPtr, const void *valuePtr, const format_desc &fd )
-	{
-		char value = *reinterpret_cast<const char *>( valuePtr );
-
-		if ( fd.type && detail::find_char( "bBdnoxX", fd.type ) )
-		{
-			return detail::numeric_formatter<W, char, detail::numeric_type::signed_integer>::write( writerPtr, &value, fd );
-		}
-
-		W &w = *reinterpret_cast<W *>( writerPtr );
-		return w.append( &value, 1 );
-	}
-};
-
-template <typename W> struct formatter<W, const char *>
-{
-	static bool write( void *writerPtr, const void *valuePtr, const format_desc &fd )
-	{
-		const char *value = *reinterpret_cast<const char *const *>( valuePtr );
-
-		W &w = *reinterpret_cast<W *>( writerPtr );
-		return w.append( value ? value : "nullptr" );
-	}
-};
+template <typename W> struct formatter<W, char> : detail::char_formatter<W, char> { };
+template <typename W> struct formatter<W, wchar_t> : detail::char_formatter<W, wchar_t> { };
+template <typename W> struct formatter<W, char16_t> : detail::char_formatter<W, char16_t> { };
+template <typename W> struct formatter<W, char32_t> : detail::char_formatter<W, char32_t> { };
+
+template <typename W> struct formatter<W, const char *> : detail::cstring_formatter<W, char> { };
+template <typename W> struct formatter<W, const wchar_t *> : detail::cstring_formatter<W, wchar_t> { };
+template <typename W> struct formatter<W, const char16_t *> : detail::cstring_formatter<W, char16_t> { };
+template <typename W> struct formatter<W, const char32_t *> : detail::cstring_formatter<W, char32_t> { };
+
+template <typename W> struct formatter<W, char *> : detail::cstring_formatter<W, char> { };
+template <typename W> struct formatter<W, wchar_t *> : detail::cstring_formatter<W, wchar_t> { };
+template <typename W> struct formatter<W, char16_t *> : detail::cstring_formatter<W, char16_t> { };
+template <typename W> struct formatter<W, char32_t *> : detail::cstring_formatter<W, char32_t> { };
+
+#if defined(__cpp_char8_t)
+template <typename W> struct formatter<W, char8_t> : detail::char_formatter<W, char8_t> { };
+template <typename W> struct formatter<W, const char8_t *> : detail::cstring_formatter<W, char8_t> { };
+template <typename W> struct formatter<W, char8_t *> : detail::cstring_formatter<W, char8_t> { };
+#endif
 
 template <typename W, size_t N> struct formatter<W, const char ( & )[N]>
 {
 	static bool write( void *writerPtr, const void *valuePtr, const format_desc &fd )
 	{
 		W &w = *reinterpret_cast<W *>( writerPtr );
-		return w.append( *reinterpret_cast<const char *( & )[N]>( valuePtr ), N - 1 );
+		return detail::write_string( w, *reinterpret_cast<const char *( & )[N]>( valuePtr ), N - 1, fd.type );
 	}
 };
 
@@ -539,36 +1528,81 @@ template <typename W, typename T> struct formatter<W, T *>
 
 //---------------------------------------------------------------------------------------------------------------------
 template <typename C>
-inline format_desc format_desc::parse(
-    const C *valuePtrFormatStr,
-    const detail::wrapper *const argPtrs,
-    size_t numArgs,
-    size_t valuePtrIndex )
+constexpr bool format_desc::parse_type( C ch ) noexcept
+{
+	// One jump instead of scanning the list of presentation types for every field
+	switch ( ch )
+	{
+		case 'b': case 'B':
+			base = 2;
+			break;
+
+		case 'o':
+			base = 8;
+			break;
+
+		case 'x': case 'X':
+			base = 16;
+			break;
+
+		case 'd': case 'n': case 'a': case 'A': case 'c': case 'e': case 'E': case 'f': case 'F': case 'g': case 'G':
+		case 'j': case 'l': case 'm': case 'M': case 'p': case 'r': case 's': case 'u': case '?':
+			break;
+
+		default:
+			return false;
+	}
+
+	type = int( ch );
+	return true;
+}
+
+template <typename C>
+constexpr format_desc format_desc::parse( const C *specStr, size_t specLength, size_t *numCharsUnparsed )
 {
 	format_desc result;
+	result.spec = specStr;
+	result.spec_length = specLength;
+	result.spec_char_size = sizeof( C );
 
-	size_t numCharsLeft = length( valuePtrFormatStr );
-	if ( !numCharsLeft )
+	if ( numCharsUnparsed )
+		*numCharsUnparsed = 0;
+
+	// No spec or a lone presentation type such as {:x} or {:?}, the common fields, are handled here where the
+	// compiler can inline them into the segment scan. Only the rest pays a call to the general parser.
+	if ( !specLength || ( specLength == 1 && result.parse_type( *specStr ) ) )
 		return result;
 
-	const auto *chars = valuePtrFormatStr;
+	result.parse_fields( specStr, specLength, numCharsUnparsed );
+	return result;
+}
 
-	// Fill character
-	if ( numCharsLeft >= 2 && ( *chars ) != '{' && ( *chars ) != '}' && detail::find_char( "<>=^", chars[1] ) )
+template <typename C>
+constexpr void format_desc::parse_fields( const C *chars, size_t numCharsLeft, size_t *numCharsUnparsed )
+{
+	// Fill character, a whole code point even when it spans several code units
 	{
-		result.fill = *chars++;
-		--numCharsLeft;
+		const auto *next = chars;
+		auto fillCh = detail::decode_utf( next, chars + numCharsLeft );
+		auto fillLen = size_t( next - chars );
+
+		if ( numCharsLeft > fillLen && fillCh != '{' && fillCh != '}' && detail::find_char( "<>=^", *next ) )
+		{
+			fill = int( fillCh );
+			chars = next;
+			numCharsLeft -= fillLen;
+		}
 	}
 
 	// Alignment
-	if ( auto alignChar = detail::find_char( "<>^=", *chars ); numCharsLeft && alignChar )
+	if ( auto alignChar = numCharsLeft ? detail::find_char( "<>^=", *chars ) : 0; alignChar )
 	{
 		if ( alignChar == '<' )
-			result.align = alignment::left;
+			align = alignment::left;
 		else if ( alignChar == '>' )
-			result.align = alignment::right;
+			align = alignment::right;
 		else if ( alignChar == '^' )
-			result.align = alignment::center;
+			align = alignment::center;
 
 		++chars;
 		--numCharsLeft;
@@ -577,14 +1611,14 @@ inline format_desc format_desc::parse(
 	// Sign
 	if ( numCharsLeft && detail::find_char( "+- ", *chars ) )
 	{
-		result.sign = *chars++;
+		sign = *chars++;
 		--numCharsLeft;
 	}
 
 	// Type prefix
 	if ( numCharsLeft && *chars == '#' )
 	{
-		result.prefix = true;
+		prefix = true;
 		++chars;
 		--numCharsLeft;
 	}
@@ -592,7 +1626,7 @@ inline format_desc format_desc::parse(
 	// Sign-aware zero-padding for numeric types
 	if ( numCharsLeft && *chars == '0' )
 	{
-		result.fill = '0';
+		fill = '0';
 
 		++chars;
 		--numCharsLeft;
@@ -600,7 +1634,7 @@ inline format_desc format_desc::parse(
 
 	// Alignment width
 	if ( numCharsLeft && detail::is_digit( *chars ) )
-		result.width = detail::string_to_uint( chars, numCharsLeft );
+		width = detail::string_to_uint( chars, numCharsLeft );
 
 	// Precision
 	if ( numCharsLeft >= 2 && *chars == '.' && detail::is_digit( chars[1] ) )
@@ -608,26 +1642,18 @@ inline format_desc format_desc::parse(
 		++chars;
 		--numCharsLeft;
 
-		result.precision = detail::string_to_uint( chars, numCharsLeft );
+		precision = detail::string_to_uint( chars, numCharsLeft );
 	}
 
 	// Type
-	if ( numCharsLeft && detail::find_char( "bBdnoxXaAceEfFgGps", *chars ) )
+	if ( numCharsLeft && parse_type( *chars ) )
 	{
-		result.type = *chars;
-
-		if ( result.type == 'b' || result.type == 'B' )
-			result.base = 2;
-		else if ( result.type == 'o' )
-			result.base = 8;
-		else if ( result.type == 'x' || result.type == 'X' )
-			result.base = 16;
-
 		++chars;
 		--numCharsLeft;
 	}
 
-	return result;
+	if ( numCharsUnparsed )
+		*numCharsUnparsed = numCharsLeft;
 }
 
 } // namespace ufmt
@@ -4,15 +4,27 @@
 	#define UFMT_NOEXCEPT noexcept
 #endif
 
+#include <bit>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
 #if !defined(UFMT_DO_NOT_USE_STL)
+	#include <array>
+	#include <memory>
 	#include <string>
 	#include <string_view>
 #endif
 
+#if !defined(UFMT_NO_SIMD) && ( defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 ) )
+	#define UFMT_SSE2 1
+	#include <emmintrin.h>
+#endif
+
 namespace ufmt {
 
 //---------------------------------------------------------------------------------------------------------------------
-template <typename C> size_t length( const C *str )
+template <typename C> constexpr size_t length( const C *str )
 {
 	size_t result = 0;
 
@@ -24,7 +36,7 @@ template <typename C> size_t length( const C *str )
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-template <typename C> bool length( const C *str, size_t &result )
+template <typename C> constexpr bool length( const C *str, size_t &result )
 {
 	if ( result == size_t( -1 ) )
 		result = length( str );
@@ -36,46 +48,87 @@ template <typename C> bool length( const C *str, size_t &result )
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-template <typename C> const C *data( const C *str ) { return str; }
+template <typename C> constexpr const C *data( const C *str ) { return str; }
 
-#if !defined(UFMT_DO_NOT_USE_STL)
-template <typename C>
-inline size_t length( const std::basic_string<C> &str ) { return str.size(); }
+//---------------------------------------------------------------------------------------------------------------------
+/* Separators of the 'n' presentation type, a lightweight stand-in for std::numpunct, see set_number_locale() */
+struct number_locale
+{
+	char thousands_sep[5] = ",";  // one UTF-8 code point, empty turns grouping off
+	char decimal_point[5] = ".";
+	unsigned char group_size = 3;  // digits next to the decimal point
+	unsigned char next_group_size = 0; // digits in every further group, 0 when the same, e.g. 2 for 12,34,567
+};
 
-template <typename C>
-inline size_t length( const std::basic_string_view<C> &strView ) { return strView.size(); }
+//---------------------------------------------------------------------------------------------------------------------
+/* Inline, zero terminated string of up to N characters, see format<N>(). Also a literal type for template arguments. */
+template <size_t N, typename C = char>
+struct fixed_string
+{
+	using value_type = C;
 
-template <typename C>
-inline const C *data( const std::basic_string<C> &str ) { return str.data(); }
+	C chars[N + 1] = { };
+	size_t count = 0;
+	bool overflowed = false;
 
-template <typename C>
-inline const C *data( const std::basic_string_view<C> &strView ) { return strView.data(); }
+	constexpr fixed_string() = default;
 
-template <typename C, typename T>
-inline void append( std::basic_string<C> &str, const T &strToAppend ) { str += strToAppend; }
+	constexpr fixed_string( const C ( &str )[N + 1] ) noexcept
+		: count( N )
+	{
+		for ( size_t i = 0; i < N; ++i )
+			chars[i] = str[i];
+	}
 
-template <typename C, typename T>
-inline void append( std::basic_string<C> &str, const T *strToAppend, size_t len )
-{
-	str.append( strToAppend, len );
-}
+	constexpr const C *data() const noexcept { return chars; }
+	constexpr const C *c_str() const noexcept { return chars; }
+	constexpr size_t size() const noexcept { return count; }
+	constexpr bool empty() const noexcept { return !count; }
+	static constexpr size_t capacity() noexcept { return N; }
 
-template <typename C, typename T>
-inline void insert( std::basic_string<C> &str, size_t pos, const T &strToInsert ) { str.insert( pos, strToInsert ); }
+	/* Output was longer than N and got cut */
+	constexpr bool truncated() const noexcept { return overflowed; }
 
-template <typename C, typename T>
-inline std::basic_string<C> convert( const T *str, size_t len )
-{
-	if constexpr ( sizeof( C ) == sizeof( T ) )
-		return std::basic_string<C>( reinterpret_cast<const C *>( str ), len );
+	constexpr const C *begin() const noexcept { return chars; }
+	constexpr const C *end() const noexcept { return chars + count; }
+
+#if !defined(UFMT_DO_NOT_USE_STL)
+	constexpr operator std::basic_string_view<C>() const noexcept { return { chars, count }; }
+#endif
+};
 
-	std::basic_string<C> result( len, 0 );
+template <size_t N, typename C> fixed_string( const C ( & )[N] ) -> fixed_string<N - 1, C>;
 
-	while ( len-- )
-		result[len] = C( str[len] );
+template <size_t N, typename C>
+constexpr size_t length( const fixed_string<N, C> &str ) { return str.size(); }
 
-	return result;
+template <size_t N, typename C>
+constexpr const C *data( const fixed_string<N, C> &str ) { return str.data(); }
+
+#if !defined(UFMT_DO_NOT_USE_STL)
+template <typename C, typename Tr, typename A>
+inline size_t length( const std::basic_string<C, Tr, A> &str ) { return str.size(); }
+
+template <typename C, typename Tr>
+constexpr size_t length( const std::basic_string_view<C, Tr> &strView ) { return strView.size(); }
+
+template <typename C, typename Tr, typename A>
+inline const C *data( const std::basic_string<C, Tr, A> &str ) { return str.data(); }
+
+template <typename C, typename Tr>
+constexpr const C *data( const std::basic_string_view<C, Tr> &strView ) { return strView.data(); }
+
+template <typename C, typename Tr, typename A, typename T>
+inline void append( std::basic_string<C, Tr, A> &str, const T &strToAppend ) { str += strToAppend; }
+
+template <typename C, typename Tr, typename A, typename T>
+inline void append( std::basic_string<C, Tr, A> &str, const T *strToAppend, size_t len )
+{
+	str.append( strToAppend, len );
 }
+
+template <typename C, typename Tr, typename A, typename T>
+inline void insert( std::basic_string<C, Tr, A> &str, size_t pos, const T &strToInsert ) { str.insert( pos, strToInsert ); }
 #endif
 
 } // namespace ufmt
@@ -91,7 +144,7 @@ template <typename C> constexpr bool is_upper( C ch ) UFMT_NOEXCEPT { return ch
 template <typename C> constexpr bool is_space( C ch ) UFMT_NOEXCEPT { return ch > 0 && ch <= 32; }
 
 //---------------------------------------------------------------------------------------------------------------------
-template <typename C> inline C find_char( const char *chars, C ch ) UFMT_NOEXCEPT
+template <typename C> constexpr C find_char( const char *chars, C ch ) UFMT_NOEXCEPT
 {
 	while ( *chars )
 		if ( auto c = *chars++; C( c ) == ch )
@@ -127,7 +180,7 @@ inline int string_to_int( const C *str ) UFMT_NOEXCEPT
 
 //---------------------------------------------------------------------------------------------------------------------
 template <typename C>
-inline unsigned string_to_uint( const C *&str, size_t &numCharsLeft ) UFMT_NOEXCEPT
+constexpr unsigned string_to_uint( const C *&str, size_t &numCharsLeft ) UFMT_NOEXCEPT
 {
 	if ( !str )
 		return 0;
@@ -138,14 +191,668 @@ inline unsigned string_to_uint( const C *&str, size_t &numCharsLeft ) UFMT_NOEXC
 		--numCharsLeft;
 	}
 
-	unsigned digit, result = 0;
-	while ( numCharsLeft-- && ( ( digit = ( unsigned( ( *str++ ) - '0' ) ) ) <= 9 ) )
-		result = result * 10 + digit;
+	unsigned result = 0;
+
+	for ( ; numCharsLeft && is_digit( *str ); ++str, --numCharsLeft )
+		result = result * 10 + unsigned( *str - C( '0' ) );
+
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+static constexpr const char *DigitPairs =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+template <typename C, typename T>
+constexpr C *uint_to_dec( T value, C *bufferEnd ) UFMT_NOEXCEPT
+{
+	if constexpr ( sizeof( T ) > 8 )
+	{
+		// 128 bit values go out in 19 digit chunks, one wide division each and the digits in 64 bit arithmetic
+		constexpr uint64_t ChunkDivisor = 10000000000000000000ull;
+		auto *c = bufferEnd;
+
+		while ( value >> 64 )
+		{
+			auto quotient = value / ChunkDivisor;
+			auto chunk = uint64_t( value - quotient * ChunkDivisor );
+			value = quotient;
+
+			auto *chunkEnd = c;
+			c = uint_to_dec( chunk, c );
+
+			while ( c > chunkEnd - 19 )
+				*--c = C( '0' );
+		}
+
+		return uint_to_dec( uint64_t( value ), c );
+	}
+
+	auto *c = bufferEnd;
+
+	// Two digits per division, written backwards from the end of the buffer
+	while ( value >= 100 )
+	{
+		auto i = unsigned( value % 100 ) * 2;
+		value /= 100;
+
+		*--c = C( DigitPairs[i + 1] );
+		*--c = C( DigitPairs[i] );
+	}
+
+	if ( value >= 10 )
+	{
+		auto i = unsigned( value ) * 2;
+
+		*--c = C( DigitPairs[i + 1] );
+		*--c = C( DigitPairs[i] );
+	}
+	else
+		*--c = C( '0' + unsigned( value ) );
+
+	return c;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <size_t N>
+constexpr size_t separator_length( const char ( &sep )[N] ) UFMT_NOEXCEPT
+{
+	size_t result = 0;
+	while ( result < N && sep[result] )
+		++result;
+
+	return result;
+}
+
+/* Whole groups of G digits, each after a separator, a constant divisor so the division compiles to a multiplication */
+template <unsigned G, typename C, typename T>
+constexpr C *uint_to_dec_groups( T value, C *c, const char *sep, size_t sepLen ) UFMT_NOEXCEPT
+{
+	constexpr uint32_t Divisor = []
+	{
+		uint32_t result = 1;
+		for ( unsigned i = 0; i < G; ++i )
+			result *= 10;
+
+		return result;
+	}();
+
+	// A full group, zero-padded to its size, two digits at a time like uint_to_dec, then its separator
+	auto putGroup = [&]( uint32_t group )
+	{
+		if constexpr ( G == 3 && sizeof( C ) == 1 )
+		{
+			// The default locale, one separator byte and three digits go out in a single store
+			if ( sepLen == 1 && !std::is_constant_evaluated() )
+			{
+				auto pair = ( group % 100 ) * 2;
+				const char chunk[4] = { *sep, char( '0' + group / 100 ), DigitPairs[pair], DigitPairs[pair + 1] };
+				c -= 4;
+				memcpy( c, chunk, 4 );
+				return;
+			}
+		}
+
+		for ( unsigned i = 0; i + 2 <= G; i += 2, group /= 100 )
+		{
+			auto pair = ( group % 100 ) * 2;
+			*--c = C( DigitPairs[pair + 1] );
+			*--c = C( DigitPairs[pair] );
+		}
+
+		if constexpr ( G % 2 )
+			*--c = C( '0' + group );
+
+		if ( sepLen == 1 )
+			*--c = C( *sep );
+		else
+		{
+			for ( auto i = sepLen; i--; )
+				*--c = C( sep[i] );
+		}
+	};
+
+	// Two groups per wide division while they fit 32 bits, halving the chain of dependent divisions
+	if constexpr ( G <= 4 )
+	{
+		while ( value >= Divisor * Divisor )
+		{
+			auto pair = uint32_t( value % ( Divisor * Divisor ) );
+			value /= Divisor * Divisor;
+
+			putGroup( pair % Divisor );
+			putGroup( pair / Divisor );
+		}
+	}
+
+	while ( value >= Divisor )
+	{
+		putGroup( uint32_t( value % Divisor ) );
+		value /= Divisor;
+	}
+
+	return uint_to_dec( value, c );
+}
+
+/* Decimal digits with a separator between groups, inserted as each group is produced instead of in a pass over the result */
+template <typename C, typename T>
+constexpr C *uint_to_dec_grouped( T value, C *bufferEnd, const number_locale &loc ) UFMT_NOEXCEPT
+{
+	// Wide values that fit 64 bits take the narrow loops
+	if constexpr ( sizeof( T ) > 8 )
+	{
+		if ( !( value >> 64 ) )
+			return uint_to_dec_grouped( uint64_t( value ), bufferEnd, loc );
+	}
+
+	const char *sep = loc.thousands_sep;
+	auto sepLen = separator_length( loc.thousands_sep );
+	unsigned groupSize = loc.group_size;
+	unsigned nextGroupSize = ( loc.next_group_size && loc.next_group_size <= 9 ) ? loc.next_group_size : groupSize;
+
+	if ( !sepLen || !groupSize || groupSize > 9 )
+		return uint_to_dec( value, bufferEnd );
+
+	auto *c = bufferEnd;
+
+	// The group next to the end may have its own size, e.g. 12,34,567. Rare enough to go one digit at a time.
+	if ( nextGroupSize != groupSize )
+	{
+		T limit = 1;
+		for ( unsigned i = 0; i < groupSize; ++i )
+			limit *= 10;
+
+		if ( value < limit )
+			return uint_to_dec( value, c );
+
+		for ( unsigned i = 0; i < groupSize; ++i, value /= 10 )
+			*--c = C( '0' + unsigned( value % 10 ) );
+
+		for ( auto i = sepLen; i--; )
+			*--c = C( sep[i] );
+	}
+
+	switch ( nextGroupSize )
+	{
+		case 1: return uint_to_dec_groups<1>( value, c, sep, sepLen );
+		case 2: return uint_to_dec_groups<2>( value, c, sep, sepLen );
+		case 3: return uint_to_dec_groups<3>( value, c, sep, sepLen );
+		case 4: return uint_to_dec_groups<4>( value, c, sep, sepLen );
+		case 5: return uint_to_dec_groups<5>( value, c, sep, sepLen );
+		case 6: return uint_to_dec_groups<6>( value, c, sep, sepLen );
+		case 7: return uint_to_dec_groups<7>( value, c, sep, sepLen );
+		case 8: return uint_to_dec_groups<8>( value, c, sep, sepLen );
+		default: return uint_to_dec_groups<9>( value, c, sep, sepLen );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename C, typename T>
+constexpr C *uint_to_chars( T value, int base, bool upperCase, C *bufferEnd ) UFMT_NOEXCEPT
+{
+	// Wide values that fit 64 bits take the narrow loops
+	if constexpr ( sizeof( T ) > 8 )
+	{
+		if ( !( value >> 64 ) )
+			return uint_to_chars( uint64_t( value ), base, upperCase, bufferEnd );
+	}
+
+	const char *digits = upperCase ? "0123456789ABCDEF" : "0123456789abcdef";
+	auto *c = bufferEnd;
+
+	// Power of two bases peel digits off with shifts, written backwards like uint_to_dec
+	switch ( base )
+	{
+		case 16:
+			do { *--c = C( digits[unsigned( value & 15 )] ); } while ( value >>= 4 );
+			break;
+
+		case 8:
+			do { *--c = C( digits[unsigned( value & 7 )] ); } while ( value >>= 3 );
+			break;
+
+		case 2:
+			do { *--c = C( digits[unsigned( value & 1 )] ); } while ( value >>= 1 );
+			break;
+
+		default:
+			c = uint_to_dec( value, bufferEnd );
+			break;
+	}
+
+	return c;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Code unit width selects the encoding: 1 = UTF-8, 2 = UTF-16, 4 = UTF-32 (wchar_t follows the platform)
+//---------------------------------------------------------------------------------------------------------------------
+template <typename C>
+constexpr char32_t decode_utf( const C *&str, const C *end ) UFMT_NOEXCEPT
+{
+	constexpr char32_t Replacement = 0xFFFD;
+
+	if constexpr ( sizeof( C ) == 1 )
+	{
+		constexpr char32_t MinValue[] = { 0, 0x80, 0x800, 0x10000 };
+
+		unsigned lead = static_cast<unsigned char>( *str++ );
+		if ( lead < 0x80 )
+			return lead;
+
+		unsigned numTrail = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC2 ? 1 : 0;
+		if ( !numTrail || lead > 0xF4 || size_t( end - str ) < numTrail )
+			return Replacement;
+
+		char32_t cp = lead & ( 0x3Fu >> numTrail );
+
+		for ( unsigned i = 0; i < numTrail; ++i )
+		{
+			unsigned trail = static_cast<unsigned char>( str[i] );
+			if ( ( trail & 0xC0 ) != 0x80 )
+				return Replacement;
+
+			cp = ( cp << 6 ) | ( trail & 0x3F );
+		}
+
+		str += numTrail;
+
+		if ( cp < MinValue[numTrail] || cp > 0x10FFFF || ( cp >= 0xD800 && cp <= 0xDFFF ) )
+			return Replacement;
+
+		return cp;
+	}
+	else if constexpr ( sizeof( C ) == 2 )
+	{
+		char32_t unit = char16_t( *str++ );
+		if ( unit < 0xD800 || unit > 0xDFFF )
+			return unit;
+
+		if ( unit <= 0xDBFF && str < end && char16_t( *str ) >= 0xDC00 && char16_t( *str ) <= 0xDFFF )
+			return 0x10000 + ( ( unit - 0xD800 ) << 10 ) + ( char16_t( *str++ ) - 0xDC00 );
+
+		return Replacement;
+	}
+	else
+	{
+		auto cp = char32_t( *str++ );
+		return ( cp > 0x10FFFF || ( cp >= 0xD800 && cp <= 0xDFFF ) ) ? Replacement : cp;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename C>
+constexpr size_t encoded_length( char32_t cp ) UFMT_NOEXCEPT
+{
+	if constexpr ( sizeof( C ) == 1 )
+		return cp < 0x80 ? 1 : cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4;
+	else if constexpr ( sizeof( C ) == 2 )
+		return cp < 0x10000 ? 1 : 2;
+	else
+		return 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename C>
+constexpr bool is_trailing_unit( C unit ) UFMT_NOEXCEPT
+{
+	// UTF-8 continuation bytes and UTF-16 low surrogates never start a code point
+	if constexpr ( sizeof( C ) == 1 )
+		return ( static_cast<unsigned char>( unit ) & 0xC0 ) == 0x80;
+	else if constexpr ( sizeof( C ) == 2 )
+		return char16_t( unit ) >= 0xDC00 && char16_t( unit ) <= 0xDFFF;
+	else
+		return false;
+}
+
+/* Largest length up to `len` that does not split a code point, `str[len]` is the first unit left out */
+template <typename C>
+constexpr size_t code_point_cut( const C *str, size_t len ) UFMT_NOEXCEPT
+{
+	for ( size_t i = 0; i < 3 && len && is_trailing_unit( str[len] ); ++i )
+		--len;
+
+	return len;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename C>
+constexpr C *encode_utf( char32_t cp, C *out ) UFMT_NOEXCEPT
+{
+	if constexpr ( sizeof( C ) == 1 )
+	{
+		if ( cp < 0x80 )
+			*out++ = C( cp );
+		else if ( cp < 0x800 )
+		{
+			*out++ = C( 0xC0 | ( cp >> 6 ) );
+			*out++ = C( 0x80 | ( cp & 0x3F ) );
+		}
+		else if ( cp < 0x10000 )
+		{
+			*out++ = C( 0xE0 | ( cp >> 12 ) );
+			*out++ = C( 0x80 | ( ( cp >> 6 ) & 0x3F ) );
+			*out++ = C( 0x80 | ( cp & 0x3F ) );
+		}
+		else
+		{
+			*out++ = C( 0xF0 | ( cp >> 18 ) );
+			*out++ = C( 0x80 | ( ( cp >> 12 ) & 0x3F ) );
+			*out++ = C( 0x80 | ( ( cp >> 6 ) & 0x3F ) );
+			*out++ = C( 0x80 | ( cp & 0x3F ) );
+		}
+	}
+	else if constexpr ( sizeof( C ) == 2 )
+	{
+		if ( cp < 0x10000 )
+			*out++ = C( cp );
+		else
+		{
+			*out++ = C( 0xD800 + ( ( cp - 0x10000 ) >> 10 ) );
+			*out++ = C( 0xDC00 + ( ( cp - 0x10000 ) & 0x3FF ) );
+		}
+	}
+	else
+		*out++ = C( cp );
+
+	return out;
+}
 
-	++numCharsLeft;
-	--str;
+//---------------------------------------------------------------------------------------------------------------------
+template <typename C>
+constexpr size_t ascii_prefix_length( const C *str, size_t len ) UFMT_NOEXCEPT
+{
+	size_t result = 0;
+
+#if defined(UFMT_SSE2)
+	// Intrinsics are not usable in constant expressions, the scalar loop below covers those
+	if ( !std::is_constant_evaluated() )
+	{
+		if constexpr ( sizeof( C ) == 1 )
+		{
+			for ( ; result + 16 <= len; result += 16 )
+				if ( _mm_movemask_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i *>( str + result ) ) ) )
+					break;
+		}
+		else if constexpr ( sizeof( C ) == 2 )
+		{
+			const auto nonAscii = _mm_set1_epi16( short( 0xFF80 ) );
+			const auto zero = _mm_setzero_si128();
+
+			for ( ; result + 8 <= len; result += 8 )
+			{
+				auto v = _mm_and_si128( _mm_loadu_si128( reinterpret_cast<const __m128i *>( str + result ) ), nonAscii );
+				if ( _mm_movemask_epi8( _mm_cmpeq_epi16( v, zero ) ) != 0xFFFF )
+					break;
+			}
+		}
+	}
+#endif
+
+	while ( result < len && static_cast<uint32_t>( str[result] ) < 0x80 )
+		++result;
+
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename D, typename S>
+constexpr size_t transcoded_length( const S *str, size_t len ) UFMT_NOEXCEPT
+{
+	if constexpr ( sizeof( D ) == sizeof( S ) )
+		return len;
+	else
+	{
+		size_t result = 0;
+		const auto *end = str + len;
+
+		while ( str < end )
+		{
+			auto numAscii = ascii_prefix_length( str, size_t( end - str ) );
+			result += numAscii;
+			str += numAscii;
+
+			if ( str < end )
+				result += encoded_length<D>( decode_utf( str, end ) );
+		}
+
+		return result;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename D, typename S>
+constexpr D *copy_ascii( const S *str, size_t len, D *out ) UFMT_NOEXCEPT
+{
+#if defined(UFMT_SSE2)
+	// Intrinsics are not usable in constant expressions, the scalar loop below covers those
+	if ( !std::is_constant_evaluated() )
+	{
+		if constexpr ( sizeof( S ) == 1 && sizeof( D ) > 1 )
+		{
+			const auto zero = _mm_setzero_si128();
+
+			// Widen 16 ASCII bytes per iteration
+			for ( ; len >= 16; len -= 16, str += 16, out += 16 )
+			{
+				auto v = _mm_loadu_si128( reinterpret_cast<const __m128i *>( str ) );
+				auto lo = _mm_unpacklo_epi8( v, zero );
+				auto hi = _mm_unpackhi_epi8( v, zero );
+
+				if constexpr ( sizeof( D ) == 2 )
+				{
+					_mm_storeu_si128( reinterpret_cast<__m128i *>( out ), lo );
+					_mm_storeu_si128( reinterpret_cast<__m128i *>( out + 8 ), hi );
+				}
+				else
+				{
+					_mm_storeu_si128( reinterpret_cast<__m128i *>( out ), _mm_unpacklo_epi16( lo, zero ) );
+					_mm_storeu_si128( reinterpret_cast<__m128i *>( out + 4 ), _mm_unpackhi_epi16( lo, zero ) );
+					_mm_storeu_si128( reinterpret_cast<__m128i *>( out + 8 ), _mm_unpacklo_epi16( hi, zero ) );
+					_mm_storeu_si128( reinterpret_cast<__m128i *>( out + 12 ), _mm_unpackhi_epi16( hi, zero ) );
+				}
+			}
+		}
+		else if constexpr ( sizeof( S ) == 2 && sizeof( D ) == 1 )
+		{
+			// Narrow 16 ASCII units per iteration
+			for ( ; len >= 16; len -= 16, str += 16, out += 16 )
+			{
+				auto lo = _mm_loadu_si128( reinterpret_cast<const __m128i *>( str ) );
+				auto hi = _mm_loadu_si128( reinterpret_cast<const __m128i *>( str + 8 ) );
+				_mm_storeu_si128( reinterpret_cast<__m128i *>( out ), _mm_packus_epi16( lo, hi ) );
+			}
+		}
+	}
+#endif
+
+	while ( len-- )
+		*out++ = D( *str++ );
+
+	return out;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename D, typename S>
+constexpr D *transcode( const S *str, size_t len, D *out, D *outEnd ) UFMT_NOEXCEPT
+{
+	if constexpr ( sizeof( D ) == sizeof( S ) )
+	{
+		if ( size_t room = size_t( outEnd - out ); len > room )
+			len = code_point_cut( str, room );
+
+		if ( std::is_constant_evaluated() )
+		{
+			for ( size_t i = 0; i < len; ++i )
+				out[i] = D( str[i] );
+		}
+		else
+			memcpy( out, str, len * sizeof( D ) );
+
+		return out + len;
+	}
+	else
+	{
+		const auto *end = str + len;
+
+		while ( str < end )
+		{
+			auto numAscii = ascii_prefix_length( str, size_t( end - str ) );
+			if ( size_t room = size_t( outEnd - out ); numAscii > room )
+				numAscii = room;
+
+			out = copy_ascii( str, numAscii, out );
+			str += numAscii;
+
+			if ( str == end )
+				break;
+
+			// Stop before a code point that no longer fits
+			const auto *next = str;
+			auto cp = decode_utf( next, end );
+
+			if ( size_t( outEnd - out ) < encoded_length<D>( cp ) )
+				break;
+
+			out = encode_utf( cp, out );
+			str = next;
+		}
+
+		return out;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+enum class escape_mode
+{
+	json,   // control characters, '"' and '\\'
+	logfmt, // the same plus ' ' and '=', which force a value into quotes
+	debug   // the same plus DEL and anything non-ASCII, which gets validated one code point at a time
+};
+
+template <escape_mode Mode, typename C>
+constexpr bool needs_escape( C ch ) UFMT_NOEXCEPT
+{
+	auto unit = uint32_t( std::make_unsigned_t<C>( ch ) );
+
+	if constexpr ( Mode == escape_mode::logfmt )
+	{
+		if ( unit == ' ' || unit == '=' )
+			return true;
+	}
+	else if constexpr ( Mode == escape_mode::debug )
+	{
+		if ( unit >= 0x7F )
+			return true;
+	}
+
+	return unit < 0x20 || unit == '"' || unit == '\\';
+}
+
+/* Length of the leading run that can be copied as-is */
+template <escape_mode Mode, typename C>
+constexpr size_t find_escape( const C *str, size_t len ) UFMT_NOEXCEPT
+{
+	size_t result = 0;
+
+#if defined(UFMT_SSE2)
+	if ( !std::is_constant_evaluated() )
+	{
+		if constexpr ( sizeof( C ) == 1 )
+		{
+			// One bit per byte of a 16 byte block that needs escaping
+			auto specialMask = []( const C *block )
+			{
+				const auto control = _mm_set1_epi8( 0x1F );
+				auto v = _mm_loadu_si128( reinterpret_cast<const __m128i *>( block ) );
+
+				// Unsigned v <= 0x1F, UTF-8 sequences pass through untouched
+				auto special = _mm_cmpeq_epi8( _mm_max_epu8( v, control ), control );
+				special = _mm_or_si128( special, _mm_or_si128( _mm_cmpeq_epi8( v, _mm_set1_epi8( '"' ) ),
+				                                               _mm_cmpeq_epi8( v, _mm_set1_epi8( '\\' ) ) ) );
+
+				if constexpr ( Mode == escape_mode::logfmt )
+				{
+					special = _mm_or_si128( special, _mm_cmpeq_epi8( v, _mm_set1_epi8( ' ' ) ) );
+					special = _mm_or_si128( special, _mm_cmpeq_epi8( v, _mm_set1_epi8( '=' ) ) );
+				}
+				else if constexpr ( Mode == escape_mode::debug )
+				{
+					// The movemask below picks up the top bit of every non-ASCII byte as it is
+					special = _mm_or_si128( special, _mm_or_si128( v, _mm_cmpeq_epi8( v, _mm_set1_epi8( 0x7F ) ) ) );
+				}
+
+				return unsigned( _mm_movemask_epi8( special ) );
+			};
+
+			for ( ; result + 16 <= len; result += 16 )
+			{
+				if ( auto mask = specialMask( str + result ) )
+					return result + size_t( std::countr_zero( mask ) );
+			}
+
+			// The last block overlaps bytes already found clean, their bits are zero
+			if ( result < len && len >= 16 )
+			{
+				auto mask = specialMask( str + len - 16 );
+				return mask ? len - 16 + size_t( std::countr_zero( mask ) ) : len;
+			}
+		}
+	}
+#endif
+
+	while ( result < len && !needs_escape<Mode>( str[result] ) )
+		++result;
+
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename C>
+constexpr size_t count_code_points( const C *str, size_t len ) UFMT_NOEXCEPT
+{
+	size_t result = 0;
+
+	// Count every unit that does not continue a previous one
+	for ( size_t i = 0; i < len; ++i )
+	{
+		if constexpr ( sizeof( C ) == 1 )
+			result += ( static_cast<unsigned char>( str[i] ) & 0xC0 ) != 0x80;
+		else if constexpr ( sizeof( C ) == 2 )
+			result += ( char16_t( str[i] ) & 0xFC00 ) != 0xDC00;
+		else
+			++result;
+	}
 
 	return result;
 }
 
 } // namespace ufmt::detail
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace ufmt {
+
+#if !defined(UFMT_DO_NOT_USE_STL)
+template <typename C, typename Tr, typename A>
+inline C *make_room( std::basic_string<C, Tr, A> &str, size_t pos, size_t len )
+{
+	if ( pos == str.size() )
+		str.resize( pos + len );
+	else
+		str.insert( pos, len, C() );
+
+	return str.data() + pos;
+}
+
+template <typename C, typename T>
+inline std::basic_string<C> convert( const T *str, size_t len )
+{
+	std::basic_string<C> result( detail::transcoded_length<C>( str, len ), C() );
+	detail::transcode( str, len, result.data(), result.data() + result.size() );
+	return result;
+}
+#endif
+
+} // namespace ufmt
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "ufmt.hpp"
+
+#include <type_traits>
+
+namespace ufmt {
+
+struct batch_result
+{
+	size_t rows = 0;
+	size_t length = 0;
+};
+
+} // namespace ufmt
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace ufmt::detail {
+
+/* Segments parsed from a row template, every segment takes at least one character so literals never need more */
+static constexpr size_t MaxRowSegments = 256;
+template <size_t N> constexpr size_t row_segments_v = ( N < MaxRowSegments ) ? N : MaxRowSegments;
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename W, typename T>
+inline void write_cell( W &w, const T &value, const format_desc &fd )
+{
+	if constexpr ( is_integer_v<T> )
+	{
+		// Plain decimal cells skip the generic numeric formatter, padded ones are aligned by it
+		if ( ( !fd.type || fd.type == 'd' ) && fd.sign == '-' && !fd.width )
+		{
+			// Decimal digits of the widest value, 128-bit columns included, and a sign
+			using U = unsigned_of_t<T>;
+
+			char buff[sizeof( U ) * 8 * 30103 / 100000 + 3];
+			auto *buffEnd = buff + sizeof( buff );
+			char *first;
+
+			if constexpr ( T( -1 ) < T( 0 ) )
+			{
+				if ( value < 0 )
+				{
+					first = uint_to_dec( U( U( 0 ) - U( value ) ), buffEnd );
+					*--first = '-';
+				}
+				else
+					first = uint_to_dec( U( value ), buffEnd );
+			}
+			else
+				first = uint_to_dec( U( value ), buffEnd );
+
+			w.append( first, size_t( buffEnd - first ) );
+			return;
+		}
+	}
+
+	formatter<W, T>::write( &w, &value, fd );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename W, typename... Ts>
+inline void write_nth_cell( W &w, size_t index, const format_desc &fd, const Ts &... values )
+{
+	size_t i = 0;
+	( void )( ( ( i++ == index ) ? ( write_cell( w, values, fd ), true ) : false ) || ... );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename W, typename C, size_t MaxSegments, typename... Ts>
+inline batch_result format_rows( W &w, const parsed_format<C, MaxSegments> &pf, size_t numRows, const Ts *... columns )
+{
+	batch_result result;
+
+	// A template cut short would lose its tail in every row, write none of them instead
+	if ( pf.overflow )
+	{
+		result.length = w.length();
+		return result;
+	}
+
+	for ( ; result.rows < numRows; ++result.rows )
+	{
+		auto rowStart = w.length();
+
+		for ( size_t i = 0; i < pf.num_segments; ++i )
+		{
+			const auto &segment = pf.segments[i];
+
+			if ( segment.literal_length )
+				append_literal( w, segment.literal, segment.literal_length );
+
+			if ( segment.index < sizeof...( Ts ) )
+			{
+				auto prevLen = w.length();
+				write_nth_cell( w, segment.index, segment.fd, columns[result.rows]... );
+
+				if ( segment.fd.width )
+					align_formatted( w, prevLen, segment.fd );
+			}
+		}
+
+		// Never leave a partial row behind in bounded outputs
+		if ( w.overflow() )
+		{
+			w.truncate( rowStart );
+			break;
+		}
+	}
+
+	result.length = w.length();
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename O, typename C, size_t MaxSegments, typename... Ts>
+inline batch_result format_rows_to_( O &output, const parsed_format<C, MaxSegments> &pf, size_t numRows, const Ts *... columns )
+{
+	static_assert( sizeof...( Ts ) > 0, "At least one column is required" );
+
+	detail::writer<O> w = { output };
+	auto start = w.length();
+	auto result = format_rows( w, pf, numRows ? 1 : 0, columns... );
+
+	// Size growable outputs once from the first row instead of letting them grow row by row
+	if constexpr ( requires { output.reserve( size_t() ); } )
+	{
+		if ( result.rows && numRows > 1 )
+		{
+			auto rowLength = result.length - start;
+			output.reserve( result.length + ( rowLength + rowLength / 8 ) * ( numRows - 1 ) );
+		}
+	}
+
+	if ( result.rows == 1 && numRows > 1 )
+	{
+		auto rest = format_rows( w, pf, numRows - 1, ( columns + 1 )... );
+		result.rows += rest.rows;
+		result.length = rest.length;
+	}
+
+	return result;
+}
+
+} // namespace ufmt::detail
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace ufmt {
+
+/*
+ * Formats `numRows` rows from structure-of-arrays columns, e.g.:
+ *
+ *   ufmt::format_rows_to( csv, "{},{:.3f},{}\n", numRows, ids, values, counts );
+ *
+ * The row template is parsed once per batch and each column is written through its formatter directly, without
+ * the per-call wrapper array. Bounded outputs only ever receive complete rows. Templates that split into more
+ * than 256 literal runs and fields are rejected, no rows are written.
+ */
+template <typename O, typename C, size_t N, typename... Ts>
+batch_result format_rows_to( O &output, const C ( &rowFormat )[N], size_t numRows, const Ts *... columns )
+{
+	const detail::parsed_format<C, detail::row_segments_v<N>> pf( rowFormat, N - 1 );
+	return detail::format_rows_to_( output, pf, numRows, columns... );
+}
+
+template <typename O, typename T, typename... Ts>
+batch_result format_rows_to( O &output, T rowFormat, size_t numRows, const Ts *... columns )
+{
+	const detail::parsed_format<std::remove_cv_t<std::remove_pointer_t<decltype( data( rowFormat ) )>>, detail::MaxRowSegments> pf(
+	    data( rowFormat ), length( rowFormat ) );
+
+	return detail::format_rows_to_( output, pf, numRows, columns... );
+}
+
+template <typename C, typename T, typename... Ts>
+batch_result format_rows_to_n( C *output, size_t outputLen, T rowFormat, size_t numRows, const Ts *... columns )
+{
+	const detail::parsed_format<std::remove_cv_t<std::remove_pointer_t<decltype( data( rowFormat ) )>>, detail::MaxRowSegments> pf(
+	    data( rowFormat ), length( rowFormat ) );
+
+	detail::buffer_writer<C> w( output, outputLen );
+	return detail::format_rows( w, pf, numRows, columns... );
+}
+
+} // namespace ufmt
@@ -0,0 +1,311 @@
+#pragma once
+
+#include "ufmt.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+
+namespace ufmt {
+
+using byte_span = std::span<const std::byte>;
+
+/* Hex digits with an optional separator inserted between groups of `group` bytes */
+struct hex_view
+{
+	byte_span bytes;
+	char separator = 0;
+	size_t group = 1;
+};
+
+/* Classic `hexdump -C` layout: offset, 16 hex bytes split in two halves and an ASCII column */
+struct hexdump_view
+{
+	byte_span bytes;
+	size_t offset = 0;
+};
+
+template <typename B, size_t E>
+inline byte_span as_byte_span( std::span<B, E> bytes ) noexcept
+{
+	return { reinterpret_cast<const std::byte *>( bytes.data() ), bytes.size_bytes() };
+}
+
+inline byte_span as_byte_span( const void *bytes, size_t numBytes ) noexcept
+{
+	return { static_cast<const std::byte *>( bytes ), numBytes };
+}
+
+template <typename T>
+inline hex_view hex( const T &bytes, char separator = 0, size_t group = 1 ) noexcept
+{
+	return { as_byte_span( std::span( bytes ) ), separator, group ? group : 1 };
+}
+
+template <typename T>
+inline hexdump_view hexdump( const T &bytes, size_t offset = 0 ) noexcept
+{
+	return { as_byte_span( std::span( bytes ) ), offset };
+}
+
+} // namespace ufmt
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace ufmt::detail {
+
+template <typename T> constexpr bool is_byte_v =
+    std::is_same_v<std::remove_cv_t<T>, std::byte> || std::is_same_v<std::remove_cv_t<T>, uint8_t> ||
+    std::is_same_v<std::remove_cv_t<T>, unsigned char>;
+
+/* Number of input bytes converted per writer append */
+static constexpr size_t HexChunkLength = 128;
+
+//---------------------------------------------------------------------------------------------------------------------
+inline char *bytes_to_hex( const uint8_t *bytes, size_t numBytes, char *output, bool upper ) UFMT_NOEXCEPT
+{
+	const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+
+#if defined(UFMT_SSE2)
+	const auto nibbleMask = _mm_set1_epi8( 0x0F );
+	const auto nine = _mm_set1_epi8( 9 );
+	const auto zero = _mm_set1_epi8( '0' );
+	const auto letterOffset = _mm_set1_epi8( char( ( upper ? 'A' : 'a' ) - '0' - 10 ) );
+
+	// 16 bytes -> 32 characters, nibbles mapped to ASCII with a compare instead of a table lookup
+	for ( ; numBytes >= 16; numBytes -= 16, bytes += 16, output += 32 )
+	{
+		auto v = _mm_loadu_si128( reinterpret_cast<const __m128i *>( bytes ) );
+		auto lo = _mm_and_si128( v, nibbleMask );
+		auto hi = _mm_and_si128( _mm_srli_epi16( v, 4 ), nibbleMask );
+
+		lo = _mm_add_epi8( _mm_add_epi8( lo, zero ), _mm_and_si128( _mm_cmpgt_epi8( lo, nine ), letterOffset ) );
+		hi = _mm_add_epi8( _mm_add_epi8( hi, zero ), _mm_and_si128( _mm_cmpgt_epi8( hi, nine ), letterOffset ) );
+
+		_mm_storeu_si128( reinterpret_cast<__m128i *>( output ), _mm_unpacklo_epi8( hi, lo ) );
+		_mm_storeu_si128( reinterpret_cast<__m128i *>( output + 16 ), _mm_unpackhi_epi8( hi, lo ) );
+	}
+#endif
+
+	while ( numBytes-- )
+	{
+		auto b = *bytes++;
+		*output++ = digits[b >> 4];
+		*output++ = digits[b & 15];
+	}
+
+	return output;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline char *bytes_to_ascii( const uint8_t *bytes, size_t numBytes, char *output ) UFMT_NOEXCEPT
+{
+#if defined(UFMT_SSE2)
+	const auto lowest = _mm_set1_epi8( 0x1F );
+	const auto highest = _mm_set1_epi8( 0x7F );
+	const auto dot = _mm_set1_epi8( '.' );
+
+	// Signed compares also reject bytes >= 0x80
+	for ( ; numBytes >= 16; numBytes -= 16, bytes += 16, output += 16 )
+	{
+		auto v = _mm_loadu_si128( reinterpret_cast<const __m128i *>( bytes ) );
+		auto printable = _mm_and_si128( _mm_cmpgt_epi8( v, lowest ), _mm_cmplt_epi8( v, highest ) );
+
+		_mm_storeu_si128( reinterpret_cast<__m128i *>( output ),
+		                  _mm_or_si128( _mm_and_si128( printable, v ), _mm_andnot_si128( printable, dot ) ) );
+	}
+#endif
+
+	while ( numBytes-- )
+	{
+		auto b = *bytes++;
+		*output++ = ( b > 0x1F && b < 0x7F ) ? char( b ) : '.';
+	}
+
+	return output;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename W>
+inline bool write_hex( W &w, byte_span bytes, bool upper, char separator, size_t group )
+{
+	char hexBuff[HexChunkLength * 2];
+	char sepBuff[HexChunkLength * 3];
+
+	const auto *cursor = reinterpret_cast<const uint8_t *>( bytes.data() );
+	size_t numBytesLeft = bytes.size();
+	size_t index = 0;
+	bool result = true;
+
+	while ( numBytesLeft )
+	{
+		auto numBytes = numBytesLeft < HexChunkLength ? numBytesLeft : HexChunkLength;
+		auto *hexEnd = bytes_to_hex( cursor, numBytes, hexBuff, upper );
+
+		if ( !separator )
+			result = w.append( hexBuff, size_t( hexEnd - hexBuff ) );
+		else
+		{
+			auto *out = sepBuff;
+
+			for ( size_t i = 0; i < numBytes; ++i, ++index )
+			{
+				if ( index && !( index % group ) )
+					*out++ = separator;
+
+				*out++ = hexBuff[i * 2];
+				*out++ = hexBuff[i * 2 + 1];
+			}
+
+			result = w.append( sepBuff, size_t( out - sepBuff ) );
+		}
+
+		cursor += numBytes;
+		numBytesLeft -= numBytes;
+	}
+
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/* "xx  " for every byte value, so a hexdump column is one 4 byte copy per byte with the spacing built in */
+struct hex_cells
+{
+	char lower[256][4] = { };
+	char upper[256][4] = { };
+
+	constexpr hex_cells()
+	{
+		for ( size_t b = 0; b < 256; ++b )
+		{
+			lower[b][0] = "0123456789abcdef"[b >> 4];
+			lower[b][1] = "0123456789abcdef"[b & 15];
+			upper[b][0] = "0123456789ABCDEF"[b >> 4];
+			upper[b][1] = "0123456789ABCDEF"[b & 15];
+			lower[b][2] = lower[b][3] = upper[b][2] = upper[b][3] = ' ';
+		}
+	}
+};
+
+inline constexpr hex_cells HexCells;
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename W>
+inline bool write_hexdump( W &w, byte_span bytes, size_t offset, bool upper )
+{
+	constexpr size_t BytesPerLine = 16;
+	constexpr size_t LinesPerChunk = 32;
+
+	// "00000000  xx xx xx xx xx xx xx xx  xx xx xx xx xx xx xx xx  |................|\n"
+	constexpr size_t HexColumn = 10;
+	constexpr size_t AsciiColumn = HexColumn + BytesPerLine * 3 + 3;
+	constexpr size_t LineLength = AsciiColumn + BytesPerLine + 2;
+
+	char chunk[LineLength * LinesPerChunk];
+	const auto &cells = upper ? HexCells.upper : HexCells.lower;
+
+	const auto *cursor = reinterpret_cast<const uint8_t *>( bytes.data() );
+	size_t numBytesLeft = bytes.size();
+	bool result = true;
+
+	while ( numBytesLeft )
+	{
+		auto *out = chunk;
+
+		for ( size_t line = 0; line < LinesPerChunk && numBytesLeft; ++line )
+		{
+			auto numBytes = numBytesLeft < BytesPerLine ? numBytesLeft : BytesPerLine;
+
+			// Only a short last line leaves cells unwritten
+			if ( numBytes < BytesPerLine )
+				memset( out, ' ', AsciiColumn );
+
+			// Every cell store also writes the two spaces after it, the next cell overwrites the second one
+			for ( size_t i = 0; i < 4; ++i )
+				memcpy( out + i * 2, cells[uint8_t( offset >> ( 24 - i * 8 ) )], 4 );
+
+			for ( size_t i = 0; i < numBytes; ++i )
+				memcpy( out + HexColumn + i * 3 + ( i >= BytesPerLine / 2 ), cells[cursor[i]], 4 );
+
+			out[AsciiColumn - 1] = '|';
+			out = bytes_to_ascii( cursor, numBytes, out + AsciiColumn );
+			*out++ = '|';
+
+			cursor += numBytes;
+			numBytesLeft -= numBytes;
+			offset += numBytes;
+
+			if ( numBytesLeft )
+				*out++ = '\n';
+		}
+
+		result = w.append( chunk, size_t( out - chunk ) );
+	}
+
+	return result;
+}
+
+} // namespace ufmt::detail
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace ufmt {
+
+template <typename B, size_t E>
+requires detail::is_byte_v<B>
+struct format_spec_types<std::span<B, E>>
+{
+	static constexpr const char *value = "xXmMru";
+};
+
+template <> struct format_spec_types<hex_view> { static constexpr const char *value = "xX"; };
+template <> struct format_spec_types<hexdump_view> { static constexpr const char *value = "xX"; };
+
+template <typename W, typename B, size_t E>
+requires detail::is_byte_v<B>
+struct formatter<W, std::span<B, E>>
+{
+	static bool write( void *writerPtr, const void *valuePtr, const format_desc &fd )
+	{
+		W &w = *reinterpret_cast<W *>( writerPtr );
+		auto value = as_byte_span( *reinterpret_cast<const std::span<B, E> *>( valuePtr ) );
+
+		// Base64, base64url, base32 or percent-encoding straight into the writer
+		if ( auto encoding = detail::encoding_of( fd.type ); encoding != detail::byte_encoding::none )
+		{
+			detail::byte_encoder encoder { encoding };
+			encoder.write( w, reinterpret_cast<const uint8_t *>( value.data() ), value.size() );
+			return encoder.finish( w );
+		}
+
+		if ( fd.prefix )
+			w.append( fd.type == 'X' ? "0X" : "0x", 2 );
+
+		return detail::write_hex( w, value, fd.type == 'X', 0, 1 );
+	}
+};
+
+template <typename W> struct formatter<W, hex_view>
+{
+	static bool write( void *writerPtr, const void *valuePtr, const format_desc &fd )
+	{
+		W &w = *reinterpret_cast<W *>( writerPtr );
+		const auto &value = *reinterpret_cast<const hex_view *>( valuePtr );
+
+		return detail::write_hex( w, value.bytes, fd.type == 'X', value.separator, value.group );
+	}
+};
+
+template <typename W> struct formatter<W, hexdump_view>
+{
+	static bool write( void *writerPtr, const void *valuePtr, const format_desc &fd )
+	{
+		W &w = *reinterpret_cast<W *>( writerPtr );
+		const auto &value = *reinterpret_cast<const hexdump_view *>( valuePtr );
+
+		return detail::write_hexdump( w, value.bytes, value.offset, fd.type == 'X' );
+	}
+};
+
+} // namespace ufmt
@@ -0,0 +1,529 @@
+#pragma once
+
+#include "ufmt.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <ratio>
+#include <stdio.h>
+#include <type_traits>
+
+namespace ufmt::detail {
+
+/* Calendar and clock fields consumed by the chrono spec renderer */
+struct chrono_fields
+{
+	int64_t year = 1970;
+	unsigned month = 1;
+	unsigned day = 1;
+	unsigned weekday = 4;
+	unsigned year_day = 0;
+	int64_t hours = 0;
+	unsigned minutes = 0;
+	unsigned seconds = 0;
+	unsigned fraction_digits = 0;
+	bool negative = false;
+
+	// Duration only, for %Q and %q
+	const char *count = nullptr;
+	const char *suffix = nullptr;
+};
+
+/* Rendered spec text with the positions of sub-second digits left to be filled in */
+struct chrono_text
+{
+	static constexpr size_t Capacity = 128;
+	static constexpr size_t MaxFractions = 4;
+
+	char text[Capacity];
+	size_t length = 0;
+	size_t fraction_pos[MaxFractions] = { };
+	size_t num_fractions = 0;
+
+	// Set when the text did not fit, it is then rendered straight into the writer instead
+	bool overflow = false;
+
+	void append( const char *str, size_t len ) noexcept
+	{
+		if ( len > Capacity - length )
+		{
+			overflow = true;
+			return;
+		}
+
+		memcpy( text + length, str, len );
+		length += len;
+	}
+
+	void append_fraction( unsigned numDigits ) noexcept
+	{
+		if ( num_fractions == MaxFractions || numDigits > Capacity - length )
+		{
+			overflow = true;
+			return;
+		}
+
+		fraction_pos[num_fractions++] = length;
+		memset( text + length, '0', numDigits );
+		length += numDigits;
+	}
+};
+
+/* Renders directly into a writer, with the sub-second digits known up front */
+template <typename W>
+struct chrono_writer
+{
+	W &w;
+	uint64_t fraction = 0;
+	bool result = true;
+
+	void append( const char *str, size_t len ) { result = w.append( str, len ) && result; }
+
+	void append_fraction( unsigned numDigits )
+	{
+		char digits[20];
+		auto value = fraction;
+
+		for ( unsigned d = numDigits; d--; value /= 10 )
+			digits[d] = char( '0' + value % 10 );
+
+		append( digits, numDigits );
+	}
+};
+
+/* Per-thread copy of the last rendered time point, valid while the second and spec stay the same */
+struct chrono_cache
+{
+	static constexpr size_t MaxSpecBytes = 64;
+
+	int64_t seconds = INT64_MIN;
+	unsigned char spec[MaxSpecBytes];
+	size_t spec_bytes = size_t( -1 );
+	unsigned fraction_digits = 0;
+	chrono_text text;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+constexpr std::intmax_t pow10( unsigned exponent ) noexcept
+{
+	std::intmax_t result = 1;
+
+	while ( exponent-- )
+		result *= 10;
+
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Period>
+constexpr unsigned fraction_digits() noexcept
+{
+	// Smallest number of decimal digits that represents one tick exactly (std::ratio is always reduced), 6 if none
+	for ( unsigned digits = 0; digits <= 18; ++digits )
+		if ( pow10( digits ) % Period::den == 0 )
+			return digits;
+
+	return 6;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline chrono_fields civil_from_seconds( int64_t seconds ) noexcept
+{
+	chrono_fields result;
+
+	auto days = seconds / 86400;
+	auto secondOfDay = seconds % 86400;
+
+	if ( secondOfDay < 0 )
+	{
+		secondOfDay += 86400;
+		--days;
+	}
+
+	result.hours = secondOfDay / 3600;
+	result.minutes = unsigned( secondOfDay / 60 % 60 );
+	result.seconds = unsigned( secondOfDay % 60 );
+	result.weekday = unsigned( ( days % 7 + 11 ) % 7 );
+
+	// Days to civil date, see http://howardhinnant.github.io/date_algorithms.html
+	days += 719468;
+	const auto era = ( days >= 0 ? days : days - 146096 ) / 146097;
+	const auto dayOfEra = unsigned( days - era * 146097 );
+	const auto yearOfEra = ( dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096 ) / 365;
+	const auto dayOfYear = dayOfEra - ( 365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100 );
+	const auto mp = ( 5 * dayOfYear + 2 ) / 153;
+
+	result.day = dayOfYear - ( 153 * mp + 2 ) / 5 + 1;
+	result.month = mp < 10 ? mp + 3 : mp - 9;
+	result.year = int64_t( yearOfEra ) + era * 400 + ( result.month <= 2 );
+
+	// Day of year counted from January 1st, dayOfYear above starts on March 1st
+	const bool leap = ( result.year % 4 == 0 && result.year % 100 != 0 ) || result.year % 400 == 0;
+	result.year_day = result.month > 2 ? dayOfYear + 59 + leap : dayOfYear - 306;
+
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename C>
+inline void transcode_spec_char( const format_desc &fd, size_t &index, char *out, size_t &numChars ) noexcept
+{
+	const auto *chars = static_cast<const C *>( fd.spec );
+	const auto *next = chars + index;
+
+	numChars = size_t( encode_utf( decode_utf( next, chars + fd.spec_length ), out ) - out );
+	index = size_t( next - chars );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Out>
+inline void render_chrono( const format_desc &fd, size_t specBegin, const chrono_fields &f, Out &out )
+{
+	static constexpr const char *WeekdayNames[] = {
+	    "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday" };
+
+	static constexpr const char *MonthNames[] = {
+	    "January", "February", "March", "April", "May", "June",
+	    "July", "August", "September", "October", "November", "December" };
+
+	auto put = [&]( const char *str, size_t len ) { out.append( str, len ); };
+
+	auto putNumber = [&]( uint64_t value, size_t minDigits, char pad = '0' ) {
+		char buff[24];
+		auto *buffEnd = buff + sizeof( buff );
+		auto *first = uint_to_dec( value, buffEnd );
+
+		while ( size_t( buffEnd - first ) < minDigits )
+			*--first = pad;
+
+		put( first, size_t( buffEnd - first ) );
+	};
+
+	auto putSeconds = [&]() {
+		putNumber( f.seconds, 2 );
+
+		if ( f.fraction_digits )
+		{
+			put( ".", 1 );
+			out.append_fraction( f.fraction_digits );
+		}
+	};
+
+	auto putYear = [&]() {
+		if ( f.year < 0 )
+			put( "-", 1 );
+
+		putNumber( f.year < 0 ? 0 - uint64_t( f.year ) : uint64_t( f.year ), 4 );
+	};
+
+	auto putDate = [&]( char separator, bool monthFirst ) {
+		if ( monthFirst )
+		{
+			putNumber( f.month, 2 );
+			put( &separator, 1 );
+			putNumber( f.day, 2 );
+			put( &separator, 1 );
+			putNumber( uint64_t( ( f.year % 100 + 100 ) % 100 ), 2 );
+		}
+		else
+		{
+			putYear();
+			put( &separator, 1 );
+			putNumber( f.month, 2 );
+			put( &separator, 1 );
+			putNumber( f.day, 2 );
+		}
+	};
+
+	// Literal spec text, wide specs are transcoded to UTF-8 a code point at a time
+	auto putSpecText = [&]( size_t &i ) {
+		char units[4];
+		size_t numUnits = 1;
+
+		if ( fd.spec_char_size == 1 )
+			units[0] = static_cast<const char *>( fd.spec )[i++];
+		else if ( fd.spec_char_size == 2 )
+			transcode_spec_char<char16_t>( fd, i, units, numUnits );
+		else
+			transcode_spec_char<char32_t>( fd, i, units, numUnits );
+
+		put( units, numUnits );
+	};
+
+	const auto *weekdayName = WeekdayNames[f.weekday % 7];
+	const auto *monthName = MonthNames[( f.month + 11 ) % 12];
+
+	if ( f.negative )
+		put( "-", 1 );
+
+	for ( size_t i = specBegin; i < fd.spec_length; )
+	{
+		if ( fd.spec_char( i ) != '%' || i + 1 == fd.spec_length )
+		{
+			putSpecText( i );
+			continue;
+		}
+
+		switch ( fd.spec_char( ++i ) )
+		{
+			case 'Y': putYear(); break;
+			case 'C': putNumber( uint64_t( f.year / 100 ), 2 ); break;
+			case 'y': putNumber( uint64_t( ( f.year % 100 + 100 ) % 100 ), 2 ); break;
+			case 'm': putNumber( f.month, 2 ); break;
+			case 'd': putNumber( f.day, 2 ); break;
+			case 'e': putNumber( f.day, 2, ' ' ); break;
+			case 'j': putNumber( f.count ? uint64_t( f.hours / 24 ) : f.year_day + 1, 3 ); break;
+			case 'H': putNumber( uint64_t( f.hours ), 2 ); break;
+			case 'I': putNumber( ( f.hours % 12 ) ? uint64_t( f.hours % 12 ) : 12, 2 ); break;
+			case 'M': putNumber( f.minutes, 2 ); break;
+			case 'S': putSeconds(); break;
+			case 'p': put( ( f.hours % 24 ) < 12 ? "AM" : "PM", 2 ); break;
+			case 'F': putDate( '-', false ); break;
+			case 'D': putDate( '/', true ); break;
+			case 'R': putNumber( uint64_t( f.hours ), 2 ); put( ":", 1 ); putNumber( f.minutes, 2 ); break;
+			case 'T': putNumber( uint64_t( f.hours ), 2 ); put( ":", 1 ); putNumber( f.minutes, 2 ); put( ":", 1 ); putSeconds(); break;
+			case 'a': put( weekdayName, 3 ); break;
+			case 'A': put( weekdayName, length( weekdayName ) ); break;
+			case 'b': case 'h': put( monthName, 3 ); break;
+			case 'B': put( monthName, length( monthName ) ); break;
+			case 'u': putNumber( f.weekday ? f.weekday : 7, 1 ); break;
+			case 'w': putNumber( f.weekday, 1 ); break;
+			case 'z': put( "+0000", 5 ); break;
+			case 'Z': put( "UTC", 3 ); break;
+			case 'Q': if ( f.count ) put( f.count, length( f.count ) ); break;
+			case 'q': if ( f.suffix ) put( f.suffix, length( f.suffix ) ); break;
+			case 'n': put( "\n", 1 ); break;
+			case 't': put( "\t", 1 ); break;
+			case '%': put( "%", 1 ); break;
+
+			default:
+			{
+				// Unknown conversions are copied through unchanged
+				put( "%", 1 );
+				putSpecText( i );
+				continue;
+			}
+		}
+
+		++i;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void put_fraction( chrono_text &text, uint64_t fraction, unsigned numDigits ) noexcept
+{
+	for ( size_t i = 0; i < text.num_fractions; ++i )
+	{
+		auto *digits = text.text + text.fraction_pos[i] + numDigits;
+		auto value = fraction;
+
+		for ( unsigned d = 0; d < numDigits; ++d, value /= 10 )
+			*--digits = char( '0' + value % 10 );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline size_t chrono_spec_begin( const format_desc &fd ) noexcept
+{
+	for ( size_t i = 0; i < fd.spec_length; ++i )
+		if ( fd.spec_char( i ) == '%' )
+			return i;
+
+	return fd.spec_length;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename Period>
+constexpr const char *duration_suffix() noexcept
+{
+	using namespace std;
+
+	if constexpr ( is_same_v<Period, nano> ) return "ns";
+	else if constexpr ( is_same_v<Period, micro> ) return "us";
+	else if constexpr ( is_same_v<Period, milli> ) return "ms";
+	else if constexpr ( is_same_v<Period, ratio<1>> ) return "s";
+	else if constexpr ( is_same_v<Period, ratio<60>> ) return "min";
+	else if constexpr ( is_same_v<Period, ratio<3600>> ) return "h";
+	else if constexpr ( is_same_v<Period, ratio<86400>> ) return "d";
+	else return nullptr;
+}
+
+} // namespace ufmt::detail
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace ufmt {
+
+/*
+ * System clock time points, rendered in UTC with strftime-like conversions, e.g. `{:%Y-%m-%d %H:%M:%S}`.
+ * The default spec is `%F %T`. `%S` includes sub-second digits at the precision of the time point's duration.
+ *
+ * The rendered text of the current second is cached per thread, so consecutive calls within the same second
+ * only rewrite the sub-second digits.
+ */
+template <typename W, typename Duration>
+struct formatter<W, std::chrono::time_point<std::chrono::system_clock, Duration>>
+{
+	static bool write( void *writerPtr, const void *valuePtr, const format_desc &fd )
+	{
+		using namespace std::chrono;
+
+		W &w = *reinterpret_cast<W *>( writerPtr );
+		const auto &value = *reinterpret_cast<const time_point<system_clock, Duration> *>( valuePtr );
+
+		constexpr auto FractionDigits = detail::fraction_digits<typename Duration::period>();
+		using fraction_t = duration<int64_t, std::ratio<1, detail::pow10( FractionDigits )>>;
+
+		auto tpSeconds = floor<seconds>( value );
+		auto numSeconds = int64_t( tpSeconds.time_since_epoch().count() );
+		auto fraction = uint64_t( duration_cast<fraction_t>( value - tpSeconds ).count() );
+
+		static constexpr char DefaultSpec[] = "%F %T";
+		format_desc specFd = fd;
+		auto specBegin = detail::chrono_spec_begin( fd );
+
+		if ( specBegin == fd.spec_length )
+		{
+			specFd.spec = DefaultSpec;
+			specFd.spec_length = sizeof( DefaultSpec ) - 1;
+			specFd.spec_char_size = 1;
+			specBegin = 0;
+		}
+
+		auto specBytes = ( specFd.spec_length - specBegin ) * specFd.spec_char_size;
+		const auto *specPtr = static_cast<const unsigned char *>( specFd.spec ) + specBegin * specFd.spec_char_size;
+
+		thread_local detail::chrono_cache cache;
+
+		if ( cache.seconds != numSeconds || cache.fraction_digits != FractionDigits || cache.spec_bytes != specBytes ||
+		     memcmp( cache.spec, specPtr, specBytes ) != 0 )
+		{
+			auto fields = detail::civil_from_seconds( numSeconds );
+			fields.fraction_digits = FractionDigits;
+
+			cache.text = detail::chrono_text();
+			detail::render_chrono( specFd, specBegin, fields, cache.text );
+
+			// Text too long for the cache is rendered into the writer every time
+			if ( cache.text.overflow )
+			{
+				cache.spec_bytes = size_t( -1 );
+
+				detail::chrono_writer<W> out = { w, fraction };
+				detail::render_chrono( specFd, specBegin, fields, out );
+				return out.result;
+			}
+
+			// Long specs are rendered every time instead of being cached
+			if ( specBytes <= detail::chrono_cache::MaxSpecBytes )
+			{
+				cache.seconds = numSeconds;
+				cache.fraction_digits = FractionDigits;
+				cache.spec_bytes = specBytes;
+				memcpy( cache.spec, specPtr, specBytes );
+			}
+			else
+				cache.spec_bytes = size_t( -1 );
+		}
+
+		detail::put_fraction( cache.text, fraction, FractionDigits );
+		return w.append( cache.text.text, cache.text.length );
+	}
+};
+
+/*
+ * Durations print as count and unit suffix by default (`42ms`). With a `%` spec the value is split into
+ * hours, minutes and seconds: `%H`, `%M`, `%S`, `%T`, `%R`, plus `%j` (days), `%Q` (count) and `%q` (suffix).
+ */
+template <typename W, typename Rep, typename Period>
+struct formatter<W, std::chrono::duration<Rep, Period>>
+{
+	static bool write( void *writerPtr, const void *valuePtr, const format_desc &fd )
+	{
+		using namespace std::chrono;
+
+		W &w = *reinterpret_cast<W *>( writerPtr );
+		const auto &value = *reinterpret_cast<const duration<Rep, Period> *>( valuePtr );
+
+		char countBuff[detail::StackBufferLength] = { };
+		char suffixBuff[detail::StackBufferLength] = { };
+		const char *suffix = detail::duration_suffix<Period>();
+
+		if constexpr ( std::is_floating_point_v<Rep> )
+			snprintf( countBuff, sizeof( countBuff ), "%g", double( value.count() ) );
+		else
+		{
+			auto *buffEnd = countBuff + sizeof( countBuff ) - 1;
+			auto count = value.count();
+			auto *first = detail::uint_to_dec( count < 0 ? 0 - uint64_t( count ) : uint64_t( count ), buffEnd );
+
+			if ( count < 0 )
+				*--first = '-';
+
+			memmove( countBuff, first, size_t( buffEnd - first ) + 1 );
+		}
+
+		if ( !suffix )
+		{
+			if constexpr ( Period::den == 1 )
+				snprintf( suffixBuff, sizeof( suffixBuff ), "[%lld]s", static_cast<long long>( Period::num ) );
+			else
+				snprintf( suffixBuff, sizeof( suffixBuff ), "[%lld/%lld]s",
+				          static_cast<long long>( Period::num ), static_cast<long long>( Period::den ) );
+
+			suffix = suffixBuff;
+		}
+
+		auto specBegin = detail::chrono_spec_begin( fd );
+
+		if ( specBegin == fd.spec_length )
+		{
+			w.append( countBuff );
+			return w.append( suffix );
+		}
+
+		constexpr auto FractionDigits = detail::fraction_digits<Period>();
+		using fraction_t = duration<int64_t, std::ratio<1, detail::pow10( FractionDigits )>>;
+
+		// Magnitude in the unsigned type, negating the most negative count would overflow
+		auto absValue = [&] {
+			if constexpr ( std::is_integral_v<Rep> )
+			{
+				using U = std::make_unsigned_t<Rep>;
+				auto count = value.count();
+				return duration<U, Period>( count < 0 ? U( U( 0 ) - U( count ) ) : U( count ) );
+			}
+			else
+				return value < duration<Rep, Period>::zero() ? -value : value;
+		}();
+
+		using seconds_t = std::conditional_t<std::is_integral_v<Rep>, duration<uint64_t>, seconds>;
+		auto wholeSeconds = floor<seconds_t>( absValue );
+
+		detail::chrono_fields fields;
+		fields.negative = value < duration<Rep, Period>::zero();
+		fields.hours = int64_t( wholeSeconds.count() / 3600 );
+		fields.minutes = unsigned( wholeSeconds.count() / 60 % 60 );
+		fields.seconds = unsigned( wholeSeconds.count() % 60 );
+		fields.fraction_digits = FractionDigits;
+		fields.count = countBuff;
+		fields.suffix = suffix;
+
+		auto fraction = uint64_t( duration_cast<fraction_t>( absValue - wholeSeconds ).count() );
+
+		detail::chrono_text text;
+		detail::render_chrono( fd, specBegin, fields, text );
+
+		if ( text.overflow )
+		{
+			detail::chrono_writer<W> out = { w, fraction };
+			detail::render_chrono( fd, specBegin, fields, out );
+			return out.result;
+		}
+
+		detail::put_fraction( text, fraction, FractionDigits );
+		return w.append( text.text, text.length );
+	}
+};
+
+} // namespace ufmt
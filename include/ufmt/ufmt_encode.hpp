@@ -0,0 +1,302 @@
+#pragma once
+
+#include "ufmt_base.hpp"
+
+#if defined(UFMT_SSE2) && ( defined(__SSSE3__) || defined(__AVX__) )
+	#define UFMT_SSSE3 1
+	#include <tmmintrin.h>
+#endif
+
+namespace ufmt::detail {
+
+/* Binary-to-text encodings of string and byte arguments, selected by presentation type */
+enum class byte_encoding
+{
+	none,
+	base64,    // 'm', RFC 4648 alphabet with '=' padding
+	base64url, // 'M', URL and filename safe alphabet, unpadded
+	base32,    // 'r', RFC 4648 alphabet with '=' padding
+	percent    // 'u', everything but RFC 3986 unreserved characters as %XX
+};
+
+constexpr byte_encoding encoding_of( int type ) noexcept
+{
+	switch ( type )
+	{
+		case 'm': return byte_encoding::base64;
+		case 'M': return byte_encoding::base64url;
+		case 'r': return byte_encoding::base32;
+		case 'u': return byte_encoding::percent;
+		default: return byte_encoding::none;
+	}
+}
+
+/* Upper bound of the encoded length of `numBytes` input bytes */
+constexpr size_t encoded_size( byte_encoding encoding, size_t numBytes ) noexcept
+{
+	switch ( encoding )
+	{
+		case byte_encoding::base64:
+		case byte_encoding::base64url: return ( numBytes + 2 ) / 3 * 4;
+		case byte_encoding::base32: return ( numBytes + 4 ) / 5 * 8;
+		case byte_encoding::percent: return numBytes * 3;
+		default: return numBytes;
+	}
+}
+
+/* Number of input bytes encoded per writer append, whole base64 and base32 groups */
+static constexpr size_t EncodeChunkLength = 240;
+
+constexpr const char *Base64Alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+constexpr const char *Base64UrlAlphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+constexpr const char *Base32Alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+
+//---------------------------------------------------------------------------------------------------------------------
+/* Whole 3 byte groups only, `numBytes` is a multiple of 3 */
+template <typename U>
+constexpr char *base64_encode( const U *in, size_t numBytes, char *out, bool urlSafe ) UFMT_NOEXCEPT
+{
+#if defined(UFMT_SSSE3)
+	if ( !std::is_constant_evaluated() )
+	{
+		// 12 bytes -> 16 characters per iteration, loads 16 so the last 4 must be readable
+		const auto shuffle = _mm_set_epi8( 10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1 );
+		const auto offsets = _mm_setr_epi8( 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		                                    '0' - 52, '0' - 52, '0' - 52, char( ( urlSafe ? '-' : '+' ) - 62 ),
+		                                    char( ( urlSafe ? '_' : '/' ) - 63 ), 'A', 0, 0 );
+
+		for ( ; numBytes >= 16; numBytes -= 12, in += 12, out += 16 )
+		{
+			auto v = _mm_shuffle_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i *>( in ) ), shuffle );
+
+			// Four 6 bit indices per 32 bit lane, moved into place with multiplies instead of variable shifts
+			auto hi = _mm_mulhi_epu16( _mm_and_si128( v, _mm_set1_epi32( 0x0FC0FC00 ) ), _mm_set1_epi32( 0x04000040 ) );
+			auto lo = _mm_mullo_epi16( _mm_and_si128( v, _mm_set1_epi32( 0x003F03F0 ) ), _mm_set1_epi32( 0x01000010 ) );
+			auto indices = _mm_or_si128( hi, lo );
+
+			// Index ranges A-Z, a-z, 0-9 and the last two each map to one offset, picked with a table lookup
+			auto range = _mm_subs_epu8( indices, _mm_set1_epi8( 51 ) );
+			range = _mm_or_si128( range, _mm_and_si128( _mm_cmpgt_epi8( _mm_set1_epi8( 26 ), indices ), _mm_set1_epi8( 13 ) ) );
+
+			_mm_storeu_si128( reinterpret_cast<__m128i *>( out ), _mm_add_epi8( indices, _mm_shuffle_epi8( offsets, range ) ) );
+		}
+	}
+#endif
+
+	const char *alphabet = urlSafe ? Base64UrlAlphabet : Base64Alphabet;
+
+	for ( ; numBytes >= 3; numBytes -= 3, in += 3, out += 4 )
+	{
+		auto bits = ( uint32_t( uint8_t( in[0] ) ) << 16 ) | ( uint32_t( uint8_t( in[1] ) ) << 8 ) | uint8_t( in[2] );
+
+		out[0] = alphabet[bits >> 18];
+		out[1] = alphabet[( bits >> 12 ) & 63];
+		out[2] = alphabet[( bits >> 6 ) & 63];
+		out[3] = alphabet[bits & 63];
+	}
+
+	return out;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/* Whole 5 byte groups only, `numBytes` is a multiple of 5 */
+template <typename U>
+constexpr char *base32_encode( const U *in, size_t numBytes, char *out ) UFMT_NOEXCEPT
+{
+	for ( ; numBytes >= 5; numBytes -= 5, in += 5, out += 8 )
+	{
+		uint64_t bits = 0;
+		for ( size_t i = 0; i < 5; ++i )
+			bits = ( bits << 8 ) | uint8_t( in[i] );
+
+		for ( size_t i = 0; i < 8; ++i )
+			out[i] = Base32Alphabet[( bits >> ( 35 - 5 * i ) ) & 31];
+	}
+
+	return out;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+constexpr bool is_url_unreserved( uint8_t b ) noexcept
+{
+	return ( b >= 'A' && b <= 'Z' ) || ( b >= 'a' && b <= 'z' ) || ( b >= '0' && b <= '9' ) || b == '-' || b == '.' ||
+	       b == '_' || b == '~';
+}
+
+template <typename U>
+constexpr char *percent_encode( const U *in, size_t numBytes, char *out ) UFMT_NOEXCEPT
+{
+#if defined(UFMT_SSE2)
+	if ( !std::is_constant_evaluated() )
+	{
+		// Bytes >= 0x80 are negative to the signed compares and fall outside every range
+		auto inRange = []( __m128i v, char lo, char hi )
+		{
+			return _mm_and_si128( _mm_cmpgt_epi8( v, _mm_set1_epi8( char( lo - 1 ) ) ), _mm_cmplt_epi8( v, _mm_set1_epi8( char( hi + 1 ) ) ) );
+		};
+
+		while ( numBytes >= 16 )
+		{
+			auto v = _mm_loadu_si128( reinterpret_cast<const __m128i *>( in ) );
+
+			auto unreserved = _mm_or_si128( _mm_or_si128( inRange( v, 'A', 'Z' ), inRange( v, 'a', 'z' ) ), inRange( v, '-', '9' ) );
+			unreserved = _mm_andnot_si128( _mm_cmpeq_epi8( v, _mm_set1_epi8( '/' ) ), unreserved );
+			unreserved = _mm_or_si128( unreserved, _mm_or_si128( _mm_cmpeq_epi8( v, _mm_set1_epi8( '_' ) ), _mm_cmpeq_epi8( v, _mm_set1_epi8( '~' ) ) ) );
+
+			// Copy the clean prefix in one store, the byte after it goes through the scalar loop below
+			auto mask = unsigned( _mm_movemask_epi8( unreserved ) );
+			auto numClean = size_t( std::countr_one( mask ) );
+
+			_mm_storeu_si128( reinterpret_cast<__m128i *>( out ), v );
+			out += numClean;
+			in += numClean;
+			numBytes -= numClean;
+
+			if ( numClean < 16 )
+				break;
+		}
+	}
+#endif
+
+	for ( ; numBytes; --numBytes, ++in )
+	{
+		auto b = uint8_t( *in );
+
+		if ( is_url_unreserved( b ) )
+			*out++ = char( b );
+		else
+		{
+			*out++ = '%';
+			*out++ = "0123456789ABCDEF"[b >> 4];
+			*out++ = "0123456789ABCDEF"[b & 15];
+		}
+	}
+
+	return out;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/* Encodes a byte stream arriving in pieces, partial base64 and base32 groups carry over to the next piece */
+struct byte_encoder
+{
+	byte_encoding encoding = byte_encoding::none;
+	uint8_t carry[5] = { };
+	size_t carry_length = 0;
+
+	constexpr size_t group_length() const noexcept
+	{
+		return ( encoding == byte_encoding::base32 ) ? 5 : ( encoding == byte_encoding::percent ) ? 1 : 3;
+	}
+
+	template <typename W, typename U>
+	constexpr bool encode_groups( W &w, const U *bytes, size_t numBytes )
+	{
+		char out[EncodeChunkLength * 3];
+		char *end = out;
+
+		if ( encoding == byte_encoding::base32 )
+			end = base32_encode( bytes, numBytes, out );
+		else if ( encoding == byte_encoding::percent )
+			end = percent_encode( bytes, numBytes, out );
+		else
+			end = base64_encode( bytes, numBytes, out, encoding == byte_encoding::base64url );
+
+		return w.append( out, size_t( end - out ) );
+	}
+
+	template <typename W, typename U>
+	constexpr bool write( W &w, const U *bytes, size_t numBytes )
+	{
+		auto groupLength = group_length();
+		bool result = true;
+
+		// Complete the group left over from the previous piece first
+		while ( carry_length && numBytes )
+		{
+			carry[carry_length++] = uint8_t( *bytes++ );
+			--numBytes;
+
+			if ( carry_length == groupLength )
+			{
+				result = encode_groups( w, carry, groupLength );
+				carry_length = 0;
+			}
+		}
+
+		while ( numBytes >= groupLength )
+		{
+			auto chunkLength = ( numBytes < EncodeChunkLength ) ? numBytes - numBytes % groupLength : EncodeChunkLength;
+			result = encode_groups( w, bytes, chunkLength );
+
+			bytes += chunkLength;
+			numBytes -= chunkLength;
+		}
+
+		while ( numBytes-- )
+			carry[carry_length++] = uint8_t( *bytes++ );
+
+		return result;
+	}
+
+	/* Encodes the incomplete last group, with padding where the encoding has it */
+	template <typename W>
+	constexpr bool finish( W &w )
+	{
+		if ( !carry_length )
+			return true;
+
+		for ( auto i = carry_length; i < 5; ++i )
+			carry[i] = 0;
+
+		char out[8];
+		size_t numChars, numPadded;
+
+		if ( encoding == byte_encoding::base32 )
+		{
+			base32_encode( carry, 5, out );
+			numChars = ( carry_length * 8 + 4 ) / 5;
+			numPadded = 8;
+		}
+		else
+		{
+			base64_encode( carry, 3, out, encoding == byte_encoding::base64url );
+			numChars = carry_length + 1;
+			numPadded = ( encoding == byte_encoding::base64 ) ? 4 : numChars;
+		}
+
+		for ( auto i = numChars; i < numPadded; ++i )
+			out[i] = '=';
+
+		carry_length = 0;
+		return w.append( out, numPadded );
+	}
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/* Text encoded as its UTF-8 bytes, wider strings are transcoded on the way in */
+template <typename W, typename C>
+constexpr bool write_encoded( W &w, const C *str, size_t len, byte_encoding encoding )
+{
+	byte_encoder encoder { encoding };
+
+	if constexpr ( sizeof( C ) == 1 )
+		encoder.write( w, str, len );
+	else
+	{
+		char utf8[EncodeChunkLength];
+		const C *end = str + len;
+
+		while ( str < end )
+		{
+			auto *out = utf8;
+			while ( str < end && out + 4 <= utf8 + sizeof( utf8 ) )
+				out = encode_utf( decode_utf( str, end ), out );
+
+			encoder.write( w, utf8, size_t( out - utf8 ) );
+		}
+	}
+
+	return encoder.finish( w );
+}
+
+} // namespace ufmt::detail
@@ -0,0 +1,219 @@
+#pragma once
+
+#include "ufmt.hpp"
+
+#if !defined(_WIN32)
+	#include <sys/uio.h>
+#endif
+
+namespace ufmt {
+
+#if defined(_WIN32)
+/* Same members as POSIX iovec, copy into WSABUF for WSASend */
+struct io_slice
+{
+	void *iov_base;
+	size_t iov_len;
+};
+#else
+using io_slice = ::iovec;
+#endif
+
+/*
+ * Formatted output as a scatter-gather list, ready for writev() / sendmsg():
+ *
+ *   ufmt::iovec_output<> out;
+ *   ufmt::format_to( out, "HTTP/1.1 200 OK\r\nContent-Length: {}\r\n...", length );
+ *   writev( fd, out.data(), int( out.size() ) );
+ *
+ * Literal runs of at least `MinReferenceLength` characters point straight into the format string, which must
+ * outlive the output. Converted arguments and short literals are copied into the scratch arena, where adjacent
+ * pieces share a single slice. Running out of slices or scratch sets the overflow flag and drops the rest.
+ */
+template <size_t MaxSlices = 64, size_t ScratchLength = 2048, size_t MinReferenceLength = 32>
+struct iovec_output
+{
+	io_slice slices[MaxSlices];
+	size_t num_slices = 0;
+
+	char scratch[ScratchLength];
+	size_t scratch_used = 0;
+
+	size_t total = 0;
+	bool overflowed = false;
+
+	const io_slice *data() const noexcept { return slices; }
+	size_t size() const noexcept { return num_slices; }
+
+	void clear() noexcept
+	{
+		num_slices = 0;
+		scratch_used = 0;
+		total = 0;
+		overflowed = false;
+	}
+
+	//-------------------------------------------------------------------------------------------------------------------
+	size_t length() const noexcept { return total; }
+	size_t remaining() const noexcept { return ScratchLength - scratch_used; }
+	bool remaining( size_t numBytes ) const noexcept { return scratch_used + numBytes <= ScratchLength; }
+
+	size_t code_points( size_t pos ) const noexcept
+	{
+		size_t result = 0;
+		size_t sliceEnd = total;
+
+		for ( size_t i = num_slices; i-- && sliceEnd > pos; )
+		{
+			auto sliceStart = sliceEnd - slices[i].iov_len;
+			auto skip = ( pos > sliceStart ) ? ( pos - sliceStart ) : 0;
+
+			result += detail::count_code_points( begin_of( slices[i] ) + skip, slices[i].iov_len - skip );
+			sliceEnd = sliceStart;
+		}
+
+		return result;
+	}
+
+	template <typename U>
+	bool append( const U *str, size_t len = size_t( -1 ), size_t repeat = 1 )
+	{
+		if ( !ufmt::length( str, len ) )
+			return true;
+
+		auto numChars = detail::transcoded_length<char>( str, len );
+
+		while ( repeat-- )
+		{
+			auto *out = reserve_scratch( numChars );
+			if ( !out )
+				return false;
+
+			detail::transcode( str, len, out, out + numChars );
+		}
+
+		return true;
+	}
+
+	bool append_literal( const char *str, size_t len )
+	{
+		if ( len < MinReferenceLength )
+			return append( str, len );
+
+		// Literal runs split by an escaped brace may still be contiguous
+		if ( num_slices && begin_of( slices[num_slices - 1] ) + slices[num_slices - 1].iov_len == str && !in_scratch( str ) )
+			slices[num_slices - 1].iov_len += len;
+		else if ( num_slices < MaxSlices )
+			slices[num_slices++] = { const_cast<char *>( str ), len };
+		else
+			return overflowed = true, false;
+
+		total += len;
+		return true;
+	}
+
+	template <typename U>
+	bool insert( size_t pos, const U *str, size_t len = size_t( -1 ), size_t repeat = 1 )
+	{
+		if ( !ufmt::length( str, len ) )
+			return true;
+
+		if ( pos == total )
+			return append( str, len, repeat );
+
+		auto numChars = detail::transcoded_length<char>( str, len );
+		auto totalChars = numChars * repeat;
+
+		// Alignment only ever inserts into the field just written, which sits at the end of the scratch arena
+		if ( !num_slices || !ends_scratch( slices[num_slices - 1] ) || pos < total - slices[num_slices - 1].iov_len ||
+		     scratch_used + totalChars > ScratchLength )
+		{
+			return overflowed = true, false;
+		}
+
+		auto *at = scratch + scratch_used - ( total - pos );
+		memmove( at + totalChars, at, total - pos );
+
+		while ( repeat-- )
+			at = detail::transcode( str, len, at, at + numChars );
+
+		slices[num_slices - 1].iov_len += totalChars;
+		scratch_used += totalChars;
+		total += totalChars;
+		return true;
+	}
+
+	bool overflow() const noexcept { return overflowed; }
+
+	void truncate( size_t len ) noexcept
+	{
+		while ( num_slices && total > len )
+		{
+			auto &slice = slices[num_slices - 1];
+			auto cut = ( total - len < slice.iov_len ) ? ( total - len ) : slice.iov_len;
+
+			if ( ends_scratch( slice ) )
+				scratch_used -= cut;
+
+			slice.iov_len -= cut;
+			total -= cut;
+
+			if ( !slice.iov_len )
+				--num_slices;
+		}
+	}
+
+	void zero_terminate()
+	{
+
+	}
+
+	//-------------------------------------------------------------------------------------------------------------------
+	static const char *begin_of( const io_slice &slice ) noexcept { return static_cast<const char *>( slice.iov_base ); }
+
+	bool in_scratch( const char *ptr ) const noexcept { return ptr >= scratch && ptr < scratch + ScratchLength; }
+
+	bool ends_scratch( const io_slice &slice ) const noexcept
+	{
+		return in_scratch( begin_of( slice ) ) && begin_of( slice ) + slice.iov_len == scratch + scratch_used;
+	}
+
+	char *reserve_scratch( size_t numChars ) noexcept
+	{
+		if ( scratch_used + numChars > ScratchLength )
+			return overflowed = true, nullptr;
+
+		auto *out = scratch + scratch_used;
+
+		// Extend the last slice when it already ends where the new piece starts
+		if ( num_slices && ends_scratch( slices[num_slices - 1] ) )
+			slices[num_slices - 1].iov_len += numChars;
+		else if ( num_slices < MaxSlices )
+			slices[num_slices++] = { out, numChars };
+		else
+			return overflowed = true, nullptr;
+
+		scratch_used += numChars;
+		total += numChars;
+		return out;
+	}
+};
+
+} // namespace ufmt
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace ufmt::detail {
+
+template <size_t MaxSlices, size_t ScratchLength, size_t MinReferenceLength>
+struct writer<iovec_output<MaxSlices, ScratchLength, MinReferenceLength>>
+	: writer_ref<iovec_output<MaxSlices, ScratchLength, MinReferenceLength>>
+{
+	using output_type = iovec_output<MaxSlices, ScratchLength, MinReferenceLength>;
+
+	bool append_literal( const char *str, size_t len ) { return this->target.append_literal( str, len ); }
+
+	writer( output_type &output ) : writer_ref<output_type>( output ) { }
+};
+
+} // namespace ufmt::detail
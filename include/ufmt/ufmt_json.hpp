@@ -0,0 +1,125 @@
+#pragma once
+
+#include "ufmt.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+namespace ufmt {
+
+/* Name/value pairs referenced until formatted, see json_object() */
+template <typename... Args>
+struct json_object_view
+{
+	std::tuple<const Args &...> fields;
+};
+
+/*
+ * JSON object written in one pass while formatting, e.g.:
+ *
+ *   ufmt::format_to( out, "{}\n", ufmt::json_object( "id", id, "user", name, "ok", ok ) );
+ *
+ * writes {"id":42,"user":"a \"quoted\" name","ok":true}. Strings and characters are escaped, non-finite floats
+ * and null pointers become null, other pointers quoted hex addresses, and objects nest. Other types are written
+ * as their formatter prints them.
+ */
+template <typename... Args>
+inline json_object_view<Args...> json_object( const Args &... fields ) noexcept
+{
+	static_assert( sizeof...( Args ) % 2 == 0, "json_object() takes name/value pairs" );
+	return { { fields... } };
+}
+
+} // namespace ufmt
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace ufmt::detail {
+
+template <typename T> constexpr bool is_json_object_v = false;
+template <typename... Args> constexpr bool is_json_object_v<json_object_view<Args...>> = true;
+
+template <typename W, typename... Args>
+inline bool write_json_object( W &w, const json_object_view<Args...> &object );
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename W, typename T>
+inline bool write_json_value( W &w, const T &value )
+{
+	using V = std::remove_cv_t<T>;
+
+	if constexpr ( std::is_same_v<V, bool> )
+		return w.append( value ? "true" : "false" );
+	else if constexpr ( std::is_same_v<V, std::nullptr_t> )
+		return w.append( "null" );
+	else if constexpr ( is_char_v<V> )
+		return write_quoted( w, &value, 1 );
+	else if constexpr ( std::is_integral_v<V> )
+		return write_integer( w, value, format_desc { } );
+	else if constexpr ( std::is_floating_point_v<V> )
+	{
+		if ( !std::isfinite( value ) )
+			return w.append( "null" );
+
+		// Shortest text that reads back to the same value
+		char buff[StackBufferLength];
+		auto result = std::to_chars( buff, buff + sizeof( buff ), value );
+		return w.append( buff, size_t( result.ptr - buff ) );
+	}
+	else if constexpr ( std::is_array_v<V> && is_char_v<std::remove_cv_t<std::remove_extent_t<V>>> )
+		return write_quoted( w, value, std::extent_v<V> - 1 );
+	else if constexpr ( std::is_pointer_v<V> && is_char_v<std::remove_cv_t<std::remove_pointer_t<V>>> )
+		return value ? write_quoted( w, value, length( value ) ) : w.append( "null" );
+	else if constexpr ( std::is_pointer_v<V> )
+	{
+		if ( !value )
+			return w.append( "null" );
+
+		// Addresses as strings, 64 bit values do not survive parsers that read numbers as doubles
+		w.append( "\"", 1 );
+		formatter<W, V>::write( &w, &value, format_desc { } );
+		return w.append( "\"", 1 );
+	}
+	else if constexpr ( is_string_v<V> )
+		return write_quoted( w, value.data(), value.size() );
+	else if constexpr ( is_json_object_v<V> )
+		return write_json_object( w, value );
+	else
+		return formatter<W, V>::write( &w, &value, format_desc { } );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename W, typename... Args>
+inline bool write_json_object( W &w, const json_object_view<Args...> &object )
+{
+	w.append( "{", 1 );
+
+	[&]<size_t... I>( std::index_sequence<I...> )
+	{
+		( ( ( I ? w.append( ",", 1 ) : true ), write_json_value( w, std::get<2 * I>( object.fields ) ), w.append( ":", 1 ),
+		    write_json_value( w, std::get<2 * I + 1>( object.fields ) ) ),
+		  ... );
+	}( std::make_index_sequence<sizeof...( Args ) / 2>() );
+
+	return w.append( "}", 1 );
+}
+
+} // namespace ufmt::detail
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace ufmt {
+
+template <typename W, typename... Args> struct formatter<W, json_object_view<Args...>>
+{
+	static bool write( void *writerPtr, const void *valuePtr, const format_desc & /*fd*/ )
+	{
+		W &w = *reinterpret_cast<W *>( writerPtr );
+		return detail::write_json_object( w, *reinterpret_cast<const json_object_view<Args...> *>( valuePtr ) );
+	}
+};
+
+} // namespace ufmt
@@ -0,0 +1,224 @@
+#pragma once
+
+#include "ufmt.hpp"
+
+#if defined(UFMT_DO_NOT_USE_STL)
+	#error "ufmt_log.hpp requires the standard library"
+#endif
+
+#include <atomic>
+#include <string>
+#include <utility>
+
+// Statements below this level are compiled out, 0 keeps everything from trace up
+#if !defined(UFMT_LOG_LEVEL)
+	#define UFMT_LOG_LEVEL 0
+#endif
+
+namespace ufmt {
+
+enum class log_level
+{
+	trace,
+	debug,
+	info,
+	warn,
+	error,
+	fatal,
+	off
+};
+
+inline constexpr log_level compile_time_log_level = log_level( UFMT_LOG_LEVEL );
+
+/* Receives every record that passed the level checks, without a trailing newline. Called on the logging thread. */
+using log_sink = void ( * )( log_level level, const char *text, size_t length );
+
+/* Argument formatted by calling `func` only when its log statement is enabled, see lazy() */
+template <typename F>
+struct lazy_value
+{
+	F func;
+};
+
+/*
+ * Defers an expensive argument until a record is actually written, e.g.:
+ *
+ *   UFMT_LOG_DEBUG( "state: {}", ufmt::lazy( [&] { return dump_state( session ); } ) );
+ *
+ * The result is formatted as the type it returns, with the spec of its field.
+ */
+template <typename F>
+inline lazy_value<F> lazy( F func )
+{
+	return { std::move( func ) };
+}
+
+template <typename F> struct format_spec_types<lazy_value<F>>
+{
+	static constexpr const char *value = format_spec_types<std::remove_cvref_t<decltype( std::declval<const F &>()() )>>::value;
+};
+
+template <typename W, typename F> struct formatter<W, lazy_value<F>>
+{
+	static bool write( void *writerPtr, const void *valuePtr, const format_desc &fd )
+	{
+		const auto &value = *reinterpret_cast<const lazy_value<F> *>( valuePtr );
+
+		const auto &result = value.func();
+		return formatter<W, std::remove_cvref_t<decltype( result )>>::write( writerPtr, &result, fd );
+	}
+};
+
+} // namespace ufmt
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace ufmt::detail {
+
+inline void default_log_sink( log_level level, const char *text, size_t length )
+{
+	static constexpr const char *LevelNames[] = { "[trace] ", "[debug] ", "[info] ", "[warn] ", "[error] ", "[fatal] ", "" };
+
+	// One fwrite per record keeps lines from different threads apart
+	std::string line = LevelNames[size_t( level )];
+	line.append( text, length );
+	line += '\n';
+
+	fwrite( line.data(), 1, line.size(), stderr );
+}
+
+inline std::atomic<log_level> log_threshold { log_level::info };
+inline std::atomic<log_sink> log_output { default_log_sink };
+
+/* Number of segments parsed_format needs for a format string */
+template <typename C, size_t N>
+consteval size_t log_segment_count( const C ( &formatStr )[N] )
+{
+	parsed_format<C, N> pf( formatStr, N - 1 );
+	return pf.num_segments ? pf.num_segments : 1;
+}
+
+/* Format string of one log statement, parsed at compile time into static storage */
+template <typename C, size_t MaxSegments>
+struct log_callsite
+{
+	const C *format;
+	size_t format_length;
+	parsed_format<C, MaxSegments> parsed;
+
+	template <size_t N>
+	consteval log_callsite( const C ( &formatStr )[N] )
+		: format( formatStr )
+		, format_length( N - 1 )
+		, parsed( formatStr, N - 1 )
+	{
+
+	}
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename W, typename C, size_t MaxSegments>
+inline void format_parsed_to( W &w, const parsed_format<C, MaxSegments> &pf, const wrapper *argPtrs )
+{
+	for ( size_t i = 0; i < pf.num_segments; ++i )
+	{
+		const auto &segment = pf.segments[i];
+
+		if ( segment.literal_length )
+			append_literal( w, segment.literal, segment.literal_length );
+
+		// Checked at compile time, every field references an argument
+		if ( segment.index != size_t( -1 ) )
+		{
+			auto prevLen = w.length();
+			argPtrs[segment.index].writeFunc( &w, argPtrs[segment.index].ptr, segment.fd );
+			align_formatted( w, prevLen, segment.fd );
+		}
+	}
+}
+
+/* Out of line on purpose, so enabled statements add a call rather than the whole formatting path to the caller */
+template <size_t MaxSegments, typename... Args>
+#if defined(_MSC_VER)
+__declspec( noinline )
+#else
+__attribute__(( noinline ))
+#endif
+void log_write( log_level level, const log_callsite<char, MaxSegments> &callsite, format_string<Args...>, Args &&... argPtrs )
+{
+	// Reused per thread, no allocation once it has grown to the longest record
+	thread_local std::string buffer;
+	buffer.clear();
+
+	writer<std::string> w( buffer );
+	const wrapper wrappedArgs[] { { &argPtrs, formatter<writer<std::string>, Args>::write }..., { } };
+
+#if defined(UFMT_STATS)
+	stats_scope stats( callsite.format, callsite.format_length, 0 );
+#endif
+	format_parsed_to( w, callsite.parsed, wrappedArgs );
+#if defined(UFMT_STATS)
+	stats.record( w.length(), false );
+#endif
+
+	log_output.load( std::memory_order_relaxed )( level, buffer.data(), buffer.size() );
+}
+
+} // namespace ufmt::detail
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace ufmt {
+
+/* Runtime threshold, records below it are skipped before their arguments are evaluated. Defaults to info. */
+inline void set_log_level( log_level level ) noexcept
+{
+	detail::log_threshold.store( level, std::memory_order_relaxed );
+}
+
+inline log_level get_log_level() noexcept
+{
+	return detail::log_threshold.load( std::memory_order_relaxed );
+}
+
+inline bool log_enabled( log_level level ) noexcept
+{
+	return level >= detail::log_threshold.load( std::memory_order_relaxed );
+}
+
+/* Where records go, nullptr restores the default that writes "[level] text\n" to stderr */
+inline void set_log_sink( log_sink sink ) noexcept
+{
+	detail::log_output.store( sink ? sink : detail::default_log_sink, std::memory_order_relaxed );
+}
+
+} // namespace ufmt
+
+/*
+ * Level filtered logging, e.g.:
+ *
+ *   UFMT_LOG_INFO( "listening on {}:{}", host, port );
+ *   UFMT_LOG( ufmt::log_level::debug, "{} bytes from {}", size, peer );
+ *
+ * Levels below UFMT_LOG_LEVEL compile to nothing. A statement below the runtime level costs one load and one branch,
+ * its arguments are not evaluated. The format string is checked against the arguments and parsed at compile time.
+ */
+#define UFMT_LOG( level, formatStr, ... ) \
+	do \
+	{ \
+		if constexpr ( ( level ) >= ::ufmt::compile_time_log_level ) \
+		{ \
+			if ( ::ufmt::log_enabled( level ) ) [[unlikely]] \
+			{ \
+				static constexpr ::ufmt::detail::log_callsite<char, ::ufmt::detail::log_segment_count( formatStr )> ufmtCallsite( formatStr ); \
+				::ufmt::detail::log_write( level, ufmtCallsite, formatStr __VA_OPT__(, ) __VA_ARGS__ ); \
+			} \
+		} \
+	} while ( false )
+
+#define UFMT_LOG_TRACE( ... ) UFMT_LOG( ::ufmt::log_level::trace, __VA_ARGS__ )
+#define UFMT_LOG_DEBUG( ... ) UFMT_LOG( ::ufmt::log_level::debug, __VA_ARGS__ )
+#define UFMT_LOG_INFO( ... ) UFMT_LOG( ::ufmt::log_level::info, __VA_ARGS__ )
+#define UFMT_LOG_WARN( ... ) UFMT_LOG( ::ufmt::log_level::warn, __VA_ARGS__ )
+#define UFMT_LOG_ERROR( ... ) UFMT_LOG( ::ufmt::log_level::error, __VA_ARGS__ )
+#define UFMT_LOG_FATAL( ... ) UFMT_LOG( ::ufmt::log_level::fatal, __VA_ARGS__ )
@@ -0,0 +1,317 @@
+#pragma once
+
+#include "ufmt.hpp"
+
+#if defined(_WIN32)
+	// Keep min/max usable as names, e.g. std::numeric_limits<T>::max() in code including this header
+	#if !defined(NOMINMAX)
+		#define NOMINMAX
+	#endif
+
+	#if !defined(WIN32_LEAN_AND_MEAN)
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace ufmt {
+
+/* What to do with a segment once the log moves past it */
+enum class sync_policy
+{
+	none,  // leave write-back to the OS
+	async, // msync( MS_ASYNC ) / FlushViewOfFile
+	sync   // msync( MS_SYNC ) / FlushViewOfFile + FlushFileBuffers
+};
+
+struct mmap_log_options
+{
+	size_t segment_size = size_t( 16 ) << 20;
+	sync_policy sync = sync_policy::none;
+	bool sequential = true; // madvise( MADV_SEQUENTIAL ), POSIX only
+	bool prefault = false;  // madvise( MADV_WILLNEED ), POSIX only
+};
+
+/*
+ * Append-only log file that formats records straight into a memory-mapped segment of the file, e.g.:
+ *
+ *   ufmt::mmap_log log;
+ *   log.open( "service.log" );
+ *   log.write( "{} {} {}\n", timestamp, level, message );
+ *
+ * The file grows one preallocated segment at a time. A record that does not fit the rest of the current segment
+ * is formatted again into a fresh segment mapped from the record's own offset, so records are never split and
+ * the file has no gaps. close() trims the preallocated tail. Not thread-safe, use one log per thread or lock.
+ */
+struct mmap_log
+{
+	mmap_log() = default;
+	mmap_log( const mmap_log & ) = delete;
+	mmap_log &operator=( const mmap_log & ) = delete;
+	~mmap_log() { close(); }
+
+	bool open( const char *path, const mmap_log_options &opts = { } );
+	void close();
+	bool flush();
+
+	bool is_open() const noexcept { return window != nullptr; }
+
+	/* Bytes of log written so far, the final file size after close() */
+	uint64_t size() const noexcept { return window_offset + uint64_t( cursor - window ); }
+
+	template <typename... Args>
+	bool write( format_string<Args...> formatStr, Args &&... argPtrs )
+	{
+		return write_( [&]( detail::buffer_writer<char> &w )
+		{
+			return detail::format_to_<false, true>( w, formatStr.str, formatStr.length, argPtrs... );
+		} );
+	}
+
+	template <typename... Args>
+	bool write( runtime_format_string<char> formatStr, Args &&... argPtrs )
+	{
+		return write_( [&]( detail::buffer_writer<char> &w )
+		{
+			return detail::format_to_<false, false>( w, formatStr.str, formatStr.length, argPtrs... );
+		} );
+	}
+
+	//-------------------------------------------------------------------------------------------------------------------
+	template <typename F>
+	bool write_( F &&formatRecord )
+	{
+		if ( !is_open() )
+			return false;
+
+		// A second attempt always fits, unless the record formats differently the second time
+		for ( int attempt = 0; attempt < 2; ++attempt )
+		{
+			detail::buffer_writer<char> w( cursor, size_t( window_end - cursor ) );
+			auto numChars = formatRecord( w );
+
+			if ( !w.overflow() )
+			{
+				cursor += numChars;
+				return true;
+			}
+
+			// Release the file too, is_open() already reports false without a window
+			if ( !map_window( size(), numChars ) )
+				return close(), false;
+		}
+
+		return false;
+	}
+
+	bool map_window( uint64_t fileOffset, size_t minLength );
+	void unmap_window( sync_policy policy );
+	bool resize_file( uint64_t newSize );
+
+	mmap_log_options options;
+	size_t granularity = 0;
+	uint64_t file_size = 0;
+
+	char *window = nullptr;
+	char *window_end = nullptr;
+	char *cursor = nullptr;
+	uint64_t window_offset = 0;
+
+#if defined(_WIN32)
+	HANDLE file = INVALID_HANDLE_VALUE;
+#else
+	int fd = -1;
+#endif
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool mmap_log::open( const char *path, const mmap_log_options &opts )
+{
+	close();
+	options = opts;
+
+#if defined(_WIN32)
+	file = CreateFileA( path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr );
+	if ( file == INVALID_HANDLE_VALUE )
+		return false;
+
+	SYSTEM_INFO si;
+	GetSystemInfo( &si );
+	granularity = si.dwAllocationGranularity;
+
+	LARGE_INTEGER fileSize;
+	if ( !GetFileSizeEx( file, &fileSize ) )
+		return close(), false;
+
+	file_size = uint64_t( fileSize.QuadPart );
+#else
+	fd = ::open( path, O_RDWR | O_CREAT | O_CLOEXEC, 0644 );
+	if ( fd < 0 )
+		return false;
+
+	granularity = size_t( sysconf( _SC_PAGESIZE ) );
+
+	struct stat st;
+	if ( fstat( fd, &st ) != 0 )
+		return close(), false;
+
+	file_size = uint64_t( st.st_size );
+#endif
+
+	// Existing content is kept, new records go after it
+	if ( !map_window( file_size, 0 ) )
+		return close(), false;
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void mmap_log::close()
+{
+	auto logSize = size();
+
+	unmap_window( options.sync );
+
+#if defined(_WIN32)
+	if ( file != INVALID_HANDLE_VALUE )
+	{
+		// Drop the preallocated tail
+		if ( file_size > logSize )
+			resize_file( logSize );
+
+		CloseHandle( file );
+		file = INVALID_HANDLE_VALUE;
+	}
+#else
+	if ( fd >= 0 )
+	{
+		// Drop the preallocated tail
+		if ( file_size > logSize )
+			resize_file( logSize );
+
+		::close( fd );
+		fd = -1;
+	}
+#endif
+
+	window_offset = 0;
+	file_size = 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool mmap_log::flush()
+{
+	if ( !is_open() || cursor == window )
+		return true;
+
+#if defined(_WIN32)
+	return FlushViewOfFile( window, size_t( cursor - window ) ) && FlushFileBuffers( file );
+#else
+	return msync( window, size_t( cursor - window ), MS_SYNC ) == 0;
+#endif
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool mmap_log::map_window( uint64_t fileOffset, size_t minLength )
+{
+	unmap_window( options.sync );
+
+	// Map from the granularity boundary at or below the offset, so the next record starts inside the new window
+	auto start = fileOffset - fileOffset % granularity;
+	auto needed = size_t( fileOffset - start ) + minLength;
+	auto length = ( options.segment_size > needed ) ? options.segment_size : needed;
+	length = ( length + granularity - 1 ) / granularity * granularity;
+
+	if ( start + length > file_size && !resize_file( start + length ) )
+		return false;
+
+#if defined(_WIN32)
+	auto end = start + length;
+	auto mapping = CreateFileMappingA( file, nullptr, PAGE_READWRITE, DWORD( end >> 32 ), DWORD( end ), nullptr );
+	if ( !mapping )
+		return false;
+
+	// The view keeps the mapping object alive
+	auto *view = MapViewOfFile( mapping, FILE_MAP_WRITE, DWORD( start >> 32 ), DWORD( start ), length );
+	CloseHandle( mapping );
+
+	if ( !view )
+		return false;
+#else
+	auto *view = mmap( nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, off_t( start ) );
+	if ( view == MAP_FAILED )
+		return false;
+
+	if ( options.sequential )
+		madvise( view, length, MADV_SEQUENTIAL );
+
+	if ( options.prefault )
+		madvise( view, length, MADV_WILLNEED );
+#endif
+
+	window = static_cast<char *>( view );
+	window_end = window + length;
+	window_offset = start;
+	cursor = window + ( fileOffset - start );
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void mmap_log::unmap_window( sync_policy policy )
+{
+	if ( !window )
+		return;
+
+	window_offset = size();
+
+#if defined(_WIN32)
+	if ( policy != sync_policy::none && cursor > window )
+	{
+		FlushViewOfFile( window, size_t( cursor - window ) );
+
+		if ( policy == sync_policy::sync )
+			FlushFileBuffers( file );
+	}
+
+	UnmapViewOfFile( window );
+#else
+	if ( policy != sync_policy::none && cursor > window )
+		msync( window, size_t( cursor - window ), ( policy == sync_policy::sync ) ? MS_SYNC : MS_ASYNC );
+
+	munmap( window, size_t( window_end - window ) );
+#endif
+
+	window = window_end = cursor = nullptr;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool mmap_log::resize_file( uint64_t newSize )
+{
+#if defined(_WIN32)
+	LARGE_INTEGER pos;
+	pos.QuadPart = LONGLONG( newSize );
+
+	if ( !SetFilePointerEx( file, pos, nullptr, FILE_BEGIN ) || !SetEndOfFile( file ) )
+		return false;
+#else
+	#if defined(__linux__)
+	// Reserve the blocks up front, so a full disk fails here instead of raising SIGBUS on a later store
+	if ( newSize > file_size && posix_fallocate( fd, off_t( file_size ), off_t( newSize - file_size ) ) != 0 )
+		return false;
+	#endif
+
+	if ( ftruncate( fd, off_t( newSize ) ) != 0 )
+		return false;
+#endif
+
+	file_size = newSize;
+	return true;
+}
+
+} // namespace ufmt
@@ -0,0 +1,308 @@
+#pragma once
+
+#include "ufmt.hpp"
+
+#include <barrier>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ufmt::detail {
+
+/* Smallest share of records worth a thread of its own */
+static constexpr size_t MinRecordsPerThread = 4096;
+
+struct alignas( 64 ) parallel_chunk
+{
+	size_t begin = 0;
+	size_t end = 0;
+	size_t offset = 0;
+	size_t length = 0;
+	std::exception_ptr error;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+inline size_t parallel_thread_count( size_t numRecords, size_t numThreads ) noexcept
+{
+	if ( !numThreads )
+		numThreads = std::thread::hardware_concurrency();
+
+	if ( auto maxThreads = numRecords / MinRecordsPerThread; numThreads > maxThreads )
+		numThreads = maxThreads;
+
+	return numThreads ? numThreads : 1;
+}
+
+/* Worker threads kept for the life of the process, started on first use and added to when a call needs more */
+class parallel_pool
+{
+public:
+	static parallel_pool &instance()
+	{
+		static parallel_pool pool;
+		return pool;
+	}
+
+	// Runs job( 0 ) on the calling thread and the other indices on workers, all at once since jobs may wait on each other
+	template <typename F>
+	bool run( size_t numJobs, F &job )
+	{
+		// One call at a time, a call made meanwhile (e.g. from inside a job) gets false and starts its own threads
+		std::unique_lock owner( busy, std::try_to_lock );
+		if ( !owner )
+			return false;
+
+		{
+			std::lock_guard guard( lock );
+
+			while ( workers.size() + 1 < numJobs )
+				workers.emplace_back( [this, seen = generation] { work( seen ); } );
+
+			invoke = []( void *context, size_t index ) { ( *static_cast<F *>( context ) )( index ); };
+			context = &job;
+			num_jobs = numJobs;
+			next_job = 1;
+			pending = numJobs - 1;
+			++generation;
+		}
+
+		wake.notify_all();
+		job( 0 );
+
+		std::unique_lock guard( lock );
+		done.wait( guard, [this] { return !pending; } );
+		return true;
+	}
+
+	~parallel_pool()
+	{
+		{
+			std::lock_guard guard( lock );
+			stopping = true;
+		}
+
+		wake.notify_all();
+
+		for ( auto &worker : workers )
+			worker.join();
+	}
+
+private:
+	void work( size_t seen )
+	{
+		std::unique_lock guard( lock );
+
+		for ( ;; )
+		{
+			wake.wait( guard, [&] { return stopping || generation != seen; } );
+
+			if ( stopping )
+				return;
+
+			seen = generation;
+
+			while ( next_job < num_jobs )
+			{
+				auto index = next_job++;
+
+				guard.unlock();
+				invoke( context, index );
+				guard.lock();
+
+				if ( !--pending )
+					done.notify_one();
+			}
+		}
+	}
+
+	std::mutex busy;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable done;
+	std::vector<std::thread> workers;
+
+	void ( *invoke )( void *, size_t ) = nullptr;
+	void *context = nullptr;
+	size_t num_jobs = 0;
+	size_t next_job = 0;
+	size_t pending = 0;
+	size_t generation = 0;
+	bool stopping = false;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename F>
+inline void run_parallel( std::vector<parallel_chunk> &chunks, F &&work )
+{
+	auto run = [&]( size_t index ) noexcept
+	{
+		try
+		{
+			work( chunks[index] );
+		}
+		catch ( ... )
+		{
+			chunks[index].error = std::current_exception();
+		}
+	};
+
+	if ( !parallel_pool::instance().run( chunks.size(), run ) )
+	{
+		std::vector<std::thread> workers;
+		workers.reserve( chunks.size() - 1 );
+
+		// The calling thread takes the first chunk itself
+		for ( size_t i = 1; i < chunks.size(); ++i )
+			workers.emplace_back( run, i );
+
+		run( 0 );
+
+		for ( auto &worker : workers )
+			worker.join();
+	}
+
+	for ( auto &chunk : chunks )
+	{
+		if ( chunk.error )
+			std::rethrow_exception( chunk.error );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename C, typename F, typename A>
+inline size_t format_many_( size_t numRecords, F &fn, size_t numThreads, A &&allocate )
+{
+	std::vector<parallel_chunk> chunks( parallel_thread_count( numRecords, numThreads ) );
+
+	for ( size_t i = 0; i < chunks.size(); ++i )
+	{
+		chunks[i].begin = numRecords * i / chunks.size();
+		chunks[i].end = numRecords * ( i + 1 ) / chunks.size();
+	}
+
+	size_t total = 0;
+	C *dest = nullptr;
+	std::exception_ptr allocateError;
+
+	// Runs once all shares are measured, on the last thread to get there, before any thread starts writing
+	auto place = [&]() noexcept
+	{
+		for ( auto &chunk : chunks )
+		{
+			if ( chunk.error )
+				return;
+
+			chunk.offset = total;
+			total += chunk.length;
+		}
+
+		try
+		{
+			dest = allocate( total );
+		}
+		catch ( ... )
+		{
+			allocateError = std::current_exception();
+		}
+	};
+
+	std::barrier measured( std::ptrdiff_t( chunks.size() ), place );
+
+	// One set of threads for both passes
+	run_parallel( chunks, [&]( parallel_chunk &chunk )
+	{
+		// Pass 1: every thread measures its share, and must reach the barrier even if that throws
+		try
+		{
+			counting_writer<C> counter;
+
+			for ( size_t i = chunk.begin; i < chunk.end; ++i )
+				fn( counter, i );
+
+			chunk.length = counter.count;
+		}
+		catch ( ... )
+		{
+			chunk.error = std::current_exception();
+		}
+
+		measured.arrive_and_wait();
+
+		// Pass 2: every thread formats straight into its own exact slice of the destination
+		if ( dest && !chunk.error )
+		{
+			buffer_writer<C> w( dest + chunk.offset, chunk.length );
+
+			for ( size_t i = chunk.begin; i < chunk.end; ++i )
+				fn( w, i );
+		}
+	} );
+
+	if ( allocateError )
+		std::rethrow_exception( allocateError );
+
+	return total;
+}
+
+} // namespace ufmt::detail
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace ufmt {
+
+/*
+ * Formats `numRecords` independent records into one contiguous output on up to `numThreads` threads (0 picks
+ * one per core), e.g.:
+ *
+ *   ufmt::format_many( report, numRecords, [&]( auto &out, size_t i )
+ *   {
+ *     ufmt::format_to( out, "{},{:.3f}\n", ids[i], values[i] );
+ *   } );
+ *
+ * When the work is split, `fn` runs twice per record, once to measure and once to write, and must produce the
+ * same output both times. Records keep their order. Returns the number of characters appended, or leaves `output`
+ * as it was if `fn` throws. The worker threads are started by the first call and reused by later ones.
+ */
+template <typename C, typename Tr, typename A, typename F>
+size_t format_many( std::basic_string<C, Tr, A> &output, size_t numRecords, F &&fn, size_t numThreads = 0 )
+{
+	auto base = output.size();
+
+	// Nothing to split, skip the measuring pass
+	if ( detail::parallel_thread_count( numRecords, numThreads ) == 1 )
+	{
+		for ( size_t i = 0; i < numRecords; ++i )
+			fn( output, i );
+
+		return output.size() - base;
+	}
+
+	try
+	{
+		return detail::format_many_<C>( numRecords, fn, numThreads, [&]( size_t total )
+		{
+			output.resize( base + total );
+			return output.data() + base;
+		} );
+	}
+	catch ( ... )
+	{
+		// Drop the slices that were sized but not all written
+		output.resize( base );
+		throw;
+	}
+}
+
+/* Writes only when all records fit, returns the required length either way */
+template <typename C, typename F>
+size_t format_many_n( C *output, size_t outputLen, size_t numRecords, F &&fn, size_t numThreads = 0 )
+{
+	return detail::format_many_<C>( numRecords, fn, numThreads, [&]( size_t total )
+	{
+		return ( total <= outputLen ) ? output : nullptr;
+	} );
+}
+
+} // namespace ufmt
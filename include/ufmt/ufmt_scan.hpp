@@ -0,0 +1,589 @@
+#pragma once
+
+#include "ufmt.hpp"
+
+#include <charconv>
+#include <limits>
+#include <string>
+#include <string_view>
+
+namespace ufmt {
+
+struct scan_result
+{
+	size_t count = 0;      // arguments assigned
+	size_t consumed = 0;   // input characters consumed
+	bool complete = false; // the whole pattern matched
+
+	explicit operator bool() const noexcept { return complete; }
+};
+
+/*
+ * Reads one value from `cursor`, advancing it past the consumed characters. `stop` is the first character of
+ * the literal following the field (0 if none), so tokens such as "key=value" split without extra whitespace.
+ */
+template <typename C, typename T> struct scanner { };
+
+/* Presentation types accepted when scanning into T, checked at compile time. nullptr leaves the spec unchecked. */
+template <typename T> struct scan_spec_types;
+
+} // namespace ufmt
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace ufmt::detail {
+
+template <typename C>
+using scanner_read_func = bool( * )( const C *&cursor, const C *end, void *valuePtr, const format_desc &fd, C stop );
+
+template <typename C> struct scan_wrapper
+{
+	void *ptr = nullptr;
+	scanner_read_func<C> readFunc = nullptr;
+};
+
+template <typename T>
+constexpr const char *default_scan_types() noexcept
+{
+	if constexpr ( std::is_same_v<T, bool> )
+		return "s";
+	else if constexpr ( is_char_v<T> )
+		return "c";
+	else if constexpr ( is_integer_v<T> )
+		return "bBdoxX";
+	else if constexpr ( std::is_floating_point_v<T> )
+		return "aAeEfFgG";
+	else if constexpr ( is_string_v<T> )
+		return "s";
+	else
+		return nullptr;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename C>
+constexpr bool is_scan_space( C ch ) noexcept
+{
+	return ch == C( ' ' ) || ( ch >= C( '\t' ) && ch <= C( '\r' ) );
+}
+
+template <typename C>
+inline void skip_spaces( const C *&cursor, const C *end ) noexcept
+{
+	while ( cursor < end && is_scan_space( *cursor ) )
+		++cursor;
+}
+
+/* Field input ends at the width limit, if any */
+template <typename C>
+inline const C *field_end( const C *cursor, const C *end, const format_desc &fd ) noexcept
+{
+	return ( fd.width && size_t( end - cursor ) > fd.width ) ? cursor + fd.width : end;
+}
+
+template <typename C>
+inline unsigned digit_value( C ch ) noexcept
+{
+	if ( unsigned( ch - C( '0' ) ) < 10 )
+		return unsigned( ch - C( '0' ) );
+
+	if ( auto letter = unsigned( ( ch | 0x20 ) - C( 'a' ) ); letter < 26 && ch < 0x80 )
+		return letter + 10;
+
+	return 36;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <unsigned Base, typename U, typename C>
+inline bool scan_digits( const C *&cursor, const C *end, U limit, U &result ) noexcept
+{
+	// Constant base, so the limit division turns into a multiplication
+	const U limitDiv = limit / Base;
+	const unsigned limitMod = unsigned( limit % Base );
+
+	const auto *first = cursor;
+	U value = 0;
+
+	for ( unsigned digit; cursor < end; ++cursor )
+	{
+		if constexpr ( Base <= 10 )
+			digit = unsigned( *cursor - C( '0' ) );
+		else
+			digit = digit_value( *cursor );
+
+		if ( digit >= Base )
+			break;
+
+		if ( value > limitDiv || ( value == limitDiv && digit > limitMod ) )
+			return false;
+
+		value = value * Base + digit;
+	}
+
+	result = value;
+	return cursor > first;
+}
+
+template <typename U, typename C>
+inline bool scan_unsigned( const C *&cursor, const C *end, unsigned base, U limit, U &result ) noexcept
+{
+	switch ( base )
+	{
+		case 2: return scan_digits<2>( cursor, end, limit, result );
+		case 8: return scan_digits<8>( cursor, end, limit, result );
+		case 16: return scan_digits<16>( cursor, end, limit, result );
+		default: return scan_digits<10>( cursor, end, limit, result );
+	}
+}
+
+template <typename T, typename C>
+inline bool scan_integer( const C *&cursor, const C *end, const format_desc &fd, T &result ) noexcept
+{
+	// Not std::numeric_limits or std::is_signed, those leave out 128-bit integers in strict standard modes
+	using U = unsigned_of_t<T>;
+	constexpr bool Signed = T( -1 ) < T( 0 );
+
+	const auto *first = cursor;
+	end = field_end( cursor, end, fd );
+
+	bool negative = false;
+	if ( cursor < end && ( *cursor == C( '-' ) || *cursor == C( '+' ) ) )
+	{
+		if constexpr ( !Signed )
+		{
+			if ( *cursor == C( '-' ) )
+				return false;
+		}
+
+		negative = ( *cursor++ == C( '-' ) );
+	}
+
+	// Optional 0x / 0b / 0o prefix, only when a digit follows
+	auto base = unsigned( fd.base );
+	if ( base != 10 && end - cursor > 2 && cursor[0] == C( '0' ) && digit_value( cursor[2] ) < base )
+	{
+		auto prefixChar = cursor[1] | 0x20;
+		if ( ( base == 16 && prefixChar == 'x' ) || ( base == 2 && prefixChar == 'b' ) || ( base == 8 && prefixChar == 'o' ) )
+			cursor += 2;
+	}
+
+	U limit = U( U( -1 ) >> ( Signed ? 1 : 0 ) ) + U( negative ? 1 : 0 );
+	U magnitude = 0;
+
+	if ( !scan_unsigned( cursor, end, base, limit, magnitude ) )
+	{
+		cursor = first;
+		return false;
+	}
+
+	result = negative ? T( U( 0 ) - magnitude ) : T( magnitude );
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+inline constexpr T exact_pow10[] = { T( 1e0 ),  T( 1e1 ),  T( 1e2 ),  T( 1e3 ),  T( 1e4 ),  T( 1e5 ),  T( 1e6 ),  T( 1e7 ),
+                                     T( 1e8 ),  T( 1e9 ),  T( 1e10 ), T( 1e11 ), T( 1e12 ), T( 1e13 ), T( 1e14 ), T( 1e15 ),
+                                     T( 1e16 ), T( 1e17 ), T( 1e18 ), T( 1e19 ), T( 1e20 ), T( 1e21 ), T( 1e22 ) };
+
+template <typename T, typename C>
+inline bool scan_float( const C *&cursor, const C *end, const format_desc &fd, T &result ) noexcept
+{
+	// Largest mantissa and power of ten that are exact in T, so one multiplication rounds correctly (Clinger)
+	constexpr uint64_t MaxExactMantissa = uint64_t( 1 ) << std::numeric_limits<T>::digits;
+	constexpr int MaxExactPow10 = std::is_same_v<T, float> ? 10 : 22;
+
+	const auto *first = cursor;
+	end = field_end( cursor, end, fd );
+
+	bool negative = false;
+	if ( cursor < end && ( *cursor == C( '-' ) || *cursor == C( '+' ) ) )
+		negative = ( *cursor++ == C( '-' ) );
+
+	// One sign only, from_chars below would accept a second '-'
+	if ( cursor < end && ( *cursor == C( '-' ) || *cursor == C( '+' ) ) )
+	{
+		cursor = first;
+		return false;
+	}
+
+	const auto *number = cursor;
+
+	if ( fd.type != 'a' && fd.type != 'A' )
+	{
+		uint64_t mantissa = 0;
+		int numDigits = 0;
+		int exponent = 0;
+
+		for ( ; cursor < end && unsigned( *cursor - C( '0' ) ) < 10; ++cursor, ++numDigits )
+			mantissa = mantissa * 10 + unsigned( *cursor - C( '0' ) );
+
+		if ( cursor < end && *cursor == C( '.' ) )
+		{
+			for ( ++cursor; cursor < end && unsigned( *cursor - C( '0' ) ) < 10; ++cursor, ++numDigits, --exponent )
+				mantissa = mantissa * 10 + unsigned( *cursor - C( '0' ) );
+		}
+
+		if ( numDigits && cursor < end && ( *cursor | 0x20 ) == 'e' )
+		{
+			const auto *expCursor = cursor + 1;
+			bool expNegative = false;
+
+			if ( expCursor < end && ( *expCursor == C( '-' ) || *expCursor == C( '+' ) ) )
+				expNegative = ( *expCursor++ == C( '-' ) );
+
+			unsigned expValue = 0;
+			if ( scan_digits<10>( expCursor, end, 9999u, expValue ) )
+			{
+				exponent += expNegative ? -int( expValue ) : int( expValue );
+				cursor = expCursor;
+			}
+		}
+
+		if ( numDigits && numDigits <= 19 && mantissa <= MaxExactMantissa && exponent >= -MaxExactPow10 &&
+		     exponent <= MaxExactPow10 )
+		{
+			auto value = T( mantissa );
+			value = ( exponent < 0 ) ? value / exact_pow10<T>[-exponent] : value * exact_pow10<T>[exponent];
+			result = negative ? -value : value;
+			return true;
+		}
+	}
+
+	// Long mantissas, large exponents, hex floats, inf and nan
+	char narrow[128];
+	const char *from = nullptr;
+	size_t numChars = size_t( end - number );
+
+	if constexpr ( sizeof( C ) == 1 )
+		from = reinterpret_cast<const char *>( number );
+	else
+	{
+		numChars = ( numChars < sizeof( narrow ) ) ? numChars : sizeof( narrow );
+		for ( size_t i = 0; i < numChars; ++i )
+			narrow[i] = ( number[i] < 0x80 ) ? char( number[i] ) : ' ';
+
+		from = narrow;
+	}
+
+	T value = 0;
+	auto format = ( fd.type == 'a' || fd.type == 'A' ) ? std::chars_format::hex : std::chars_format::general;
+	auto [ptr, ec] = std::from_chars( from, from + numChars, value, format );
+
+	if ( ec != std::errc() )
+	{
+		cursor = first;
+		return false;
+	}
+
+	cursor = number + ( ptr - from );
+	result = negative ? -value : value;
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename C>
+inline const C *scan_token( const C *&cursor, const C *end, const format_desc &fd, C stop ) noexcept
+{
+	const auto *first = cursor;
+	end = field_end( cursor, end, fd );
+
+	while ( cursor < end && !is_scan_space( *cursor ) && ( !stop || *cursor != stop ) )
+		++cursor;
+
+	return first;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename C>
+inline bool match_literal( const C *&cursor, const C *end, const C *literal, size_t literalLen ) noexcept
+{
+	for ( const auto *literalEnd = literal + literalLen; literal < literalEnd; )
+	{
+		// Whitespace in the pattern matches any amount of whitespace, including none
+		if ( is_scan_space( *literal ) )
+		{
+			while ( literal < literalEnd && is_scan_space( *literal ) )
+				++literal;
+
+			skip_spaces( cursor, end );
+			continue;
+		}
+
+		if ( cursor == end || *cursor != *literal )
+			return false;
+
+		++cursor;
+		++literal;
+	}
+
+	return true;
+}
+
+/* Pattern segment reduced to what scanning needs, so a compile-time parsed pattern is cheap to pass around */
+template <typename C> struct scan_segment
+{
+	const C *literal = nullptr;
+	uint32_t literal_length = 0;
+	uint32_t width = 0;
+	uint16_t index = uint16_t( -1 );
+	uint8_t base = 10;
+	char type = 0;
+	C stop = 0;
+};
+
+template <typename C, size_t MaxSegments> struct parsed_scan
+{
+	scan_segment<C> segments[MaxSegments];
+	size_t num_segments = 0;
+	bool overflow = false;
+
+	constexpr parsed_scan( const C *patternStr, size_t patternLen ) noexcept
+	{
+		const parsed_format<C, MaxSegments> pf( patternStr, patternLen );
+
+		for ( ; num_segments < pf.num_segments; ++num_segments )
+		{
+			const auto &from = pf.segments[num_segments];
+			auto &to = segments[num_segments];
+
+			to.literal = from.literal;
+			to.literal_length = uint32_t( from.literal_length );
+
+			if ( from.index != size_t( -1 ) )
+			{
+				to.index = uint16_t( from.index );
+				to.width = uint32_t( from.fd.width );
+				to.base = uint8_t( from.fd.base );
+				to.type = char( from.fd.type );
+			}
+
+			// Tokens also end where the next literal starts
+			if ( num_segments + 1 < pf.num_segments )
+			{
+				const auto &next = pf.segments[num_segments + 1];
+				if ( next.literal_length && !is_scan_space( next.literal[0] ) )
+					to.stop = next.literal[0];
+			}
+		}
+
+		overflow = pf.overflow || pf.num_args > uint16_t( -1 );
+	}
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename C, size_t MaxSegments>
+inline scan_result scan_parsed( const C *input, size_t inputLen, const parsed_scan<C, MaxSegments> &ps,
+                                const scan_wrapper<C> *args, size_t numArgs )
+{
+	scan_result result;
+
+	const auto *cursor = input;
+	const auto *end = input + inputLen;
+	bool matched = !ps.overflow;
+
+	for ( size_t i = 0; matched && i < ps.num_segments; ++i )
+	{
+		const auto &segment = ps.segments[i];
+
+		if ( !match_literal( cursor, end, segment.literal, segment.literal_length ) )
+			matched = false;
+		else if ( segment.index != uint16_t( -1 ) )
+		{
+			format_desc fd;
+			fd.width = segment.width;
+			fd.base = segment.base;
+			fd.type = segment.type;
+
+			if ( segment.index < numArgs && args[segment.index].readFunc( cursor, end, args[segment.index].ptr, fd, segment.stop ) )
+				++result.count;
+			else
+				matched = false;
+		}
+	}
+
+	result.complete = matched;
+	result.consumed = size_t( cursor - input );
+	return result;
+}
+
+template <typename C, typename... Args>
+consteval void check_scan_string( const C *str, size_t len )
+{
+	constexpr const char *SpecTypes[] = { scan_spec_types<std::decay_t<Args>>::value..., nullptr };
+	check_fields( str, len, SpecTypes, sizeof...( Args ) );
+}
+
+/* Escaped braces add literal-only segments, leave room for a few on top of one segment per field */
+template <typename... Args> constexpr size_t scan_segments_v = sizeof...( Args ) + 4;
+
+} // namespace ufmt::detail
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace ufmt {
+
+template <typename T> struct scan_spec_types
+{
+	static constexpr const char *value = detail::default_scan_types<T>();
+};
+
+/* Scan pattern validated and split into segments at compile time */
+template <typename C, typename... Args> struct basic_scan_string
+{
+	detail::parsed_scan<C, detail::scan_segments_v<Args...>> parsed;
+
+	template <size_t N>
+	consteval basic_scan_string( const C ( &patternStr )[N] )
+		: parsed( patternStr, N - 1 )
+	{
+		detail::check_scan_string<C, Args...>( patternStr, N - 1 );
+
+		if ( parsed.overflow )
+			detail::format_error( "too many escaped braces in scan pattern, use ufmt::runtime()" );
+	}
+};
+
+template <typename... Args> using scan_string = basic_scan_string<char, std::type_identity_t<Args>...>;
+template <typename... Args> using wscan_string = basic_scan_string<wchar_t, std::type_identity_t<Args>...>;
+
+/*
+ * Parses `input` with the format grammar, e.g.:
+ *
+ *   int code; std::string_view method; double seconds;
+ *   if ( ufmt::scan( line, "{} {} took {}s", code, method, seconds ) ) ...
+ *
+ * Integers accept every base of the formatter (`{:x}`, `{:#b}`, ...) with overflow detection, strings are views
+ * into the input and a width limits how many characters a field may take (`{:4}{:2}{:2}` for "20231114").
+ * Whitespace in the pattern matches any run of whitespace, values skip leading whitespace except for chars.
+ */
+template <typename... Args>
+scan_result scan( std::string_view input, scan_string<Args...> pattern, Args &... args )
+{
+	const detail::scan_wrapper<char> wrappedArgs[] { { &args, scanner<char, Args>::read }..., { } };
+	return detail::scan_parsed( input.data(), input.size(), pattern.parsed, wrappedArgs, sizeof...( Args ) );
+}
+
+template <typename... Args>
+scan_result scan( std::wstring_view input, wscan_string<Args...> pattern, Args &... args )
+{
+	const detail::scan_wrapper<wchar_t> wrappedArgs[] { { &args, scanner<wchar_t, Args>::read }..., { } };
+	return detail::scan_parsed( input.data(), input.size(), pattern.parsed, wrappedArgs, sizeof...( Args ) );
+}
+
+template <typename C, typename... Args>
+scan_result scan( std::basic_string_view<std::type_identity_t<C>> input, runtime_format_string<C> pattern, Args &... args )
+{
+	const detail::parsed_scan<C, 32> parsed( pattern.str, pattern.length );
+	const detail::scan_wrapper<C> wrappedArgs[] { { &args, scanner<C, Args>::read }..., { } };
+	return detail::scan_parsed( input.data(), input.size(), parsed, wrappedArgs, sizeof...( Args ) );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+template <typename C, typename T>
+requires detail::is_integer_v<T>
+struct scanner<C, T>
+{
+	static bool read( const C *&cursor, const C *end, void *valuePtr, const format_desc &fd, C /*stop*/ )
+	{
+		detail::skip_spaces( cursor, end );
+		return detail::scan_integer( cursor, end, fd, *static_cast<T *>( valuePtr ) );
+	}
+};
+
+template <typename C, typename T>
+requires std::is_floating_point_v<T>
+struct scanner<C, T>
+{
+	static bool read( const C *&cursor, const C *end, void *valuePtr, const format_desc &fd, C /*stop*/ )
+	{
+		detail::skip_spaces( cursor, end );
+		return detail::scan_float( cursor, end, fd, *static_cast<T *>( valuePtr ) );
+	}
+};
+
+template <typename C> struct scanner<C, bool>
+{
+	static bool read( const C *&cursor, const C *end, void *valuePtr, const format_desc &fd, C stop )
+	{
+		detail::skip_spaces( cursor, end );
+
+		const auto *first = detail::scan_token( cursor, end, fd, stop );
+		const std::basic_string_view<C> token( first, size_t( cursor - first ) );
+		auto &value = *static_cast<bool *>( valuePtr );
+
+		if ( token.size() == 1 && ( token[0] == C( '0' ) || token[0] == C( '1' ) ) )
+			value = ( token[0] == C( '1' ) );
+		else if ( token.size() == 4 && token[0] == C( 't' ) && token[1] == C( 'r' ) && token[2] == C( 'u' ) && token[3] == C( 'e' ) )
+			value = true;
+		else if ( token.size() == 5 && token[0] == C( 'f' ) && token[1] == C( 'a' ) && token[2] == C( 'l' ) &&
+		          token[3] == C( 's' ) && token[4] == C( 'e' ) )
+			value = false;
+		else
+			return cursor = first, false;
+
+		return true;
+	}
+};
+
+/*
+ * A single character, leading whitespace included. With a width the field takes that many characters, as padded
+ * by the formatter, and the value is the first one that is not a space.
+ */
+template <typename C> struct scanner<C, C>
+{
+	static bool read( const C *&cursor, const C *end, void *valuePtr, const format_desc &fd, C /*stop*/ )
+	{
+		if ( cursor == end )
+			return false;
+
+		auto &value = *static_cast<C *>( valuePtr );
+		value = *cursor;
+
+		if ( fd.width > 1 )
+		{
+			const auto *fieldEnd = detail::field_end( cursor, end, fd );
+
+			for ( const auto *next = cursor; next < fieldEnd; ++next )
+			{
+				if ( *next != C( ' ' ) )
+				{
+					value = *next;
+					break;
+				}
+			}
+
+			cursor = fieldEnd;
+		}
+		else
+			++cursor;
+
+		return true;
+	}
+};
+
+/* Whitespace or `stop` delimited token, viewing the input without copying */
+template <typename C, typename Tr> struct scanner<C, std::basic_string_view<C, Tr>>
+{
+	static bool read( const C *&cursor, const C *end, void *valuePtr, const format_desc &fd, C stop )
+	{
+		detail::skip_spaces( cursor, end );
+
+		const auto *first = detail::scan_token( cursor, end, fd, stop );
+		*static_cast<std::basic_string_view<C, Tr> *>( valuePtr ) = { first, size_t( cursor - first ) };
+		return cursor > first;
+	}
+};
+
+template <typename C, typename Tr, typename A> struct scanner<C, std::basic_string<C, Tr, A>>
+{
+	static bool read( const C *&cursor, const C *end, void *valuePtr, const format_desc &fd, C stop )
+	{
+		detail::skip_spaces( cursor, end );
+
+		const auto *first = detail::scan_token( cursor, end, fd, stop );
+		static_cast<std::basic_string<C, Tr, A> *>( valuePtr )->assign( first, size_t( cursor - first ) );
+		return cursor > first;
+	}
+};
+
+} // namespace ufmt
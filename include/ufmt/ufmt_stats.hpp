@@ -0,0 +1,336 @@
+#pragma once
+
+#include "ufmt_base.hpp"
+
+#if defined(UFMT_DO_NOT_USE_STL)
+	#error "ufmt_stats.hpp requires the standard library"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(_MSC_VER) && ( defined(_M_X64) || defined(_M_IX86) )
+	#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+	#include <x86intrin.h>
+#else
+	#include <chrono>
+#endif
+
+// One in this many calls per format string is timed, must be a power of two
+#if !defined(UFMT_STATS_SAMPLE_RATE)
+	#define UFMT_STATS_SAMPLE_RATE 16
+#endif
+
+namespace ufmt::detail {
+
+static constexpr size_t StatsTableSize = 256; // distinct format strings tracked per thread
+static constexpr size_t StatsTextLength = 64; // leading characters of the format string kept for reports
+static constexpr size_t StatsHistogramSize = 32;
+
+static_assert( ( UFMT_STATS_SAMPLE_RATE & ( UFMT_STATS_SAMPLE_RATE - 1 ) ) == 0, "UFMT_STATS_SAMPLE_RATE must be a power of two" );
+
+/* Counters of one format string on one thread, only ever written by that thread */
+struct stats_entry
+{
+	std::atomic<const void *> key { nullptr };
+	char text[StatsTextLength] = { };
+
+	std::atomic<uint64_t> calls;
+	std::atomic<uint64_t> bytes;
+	std::atomic<uint64_t> truncations;
+	std::atomic<uint64_t> samples;
+	std::atomic<uint64_t> histogram[StatsHistogramSize]; // bucket i counts samples of [2^(i-1), 2^i) ticks
+};
+
+struct stats_table
+{
+	stats_entry entries[StatsTableSize];
+	stats_entry other; // everything past a full table
+	std::atomic<bool> in_use { false };
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+/* Single writer, so a plain load and store is enough and readers never see a torn value */
+inline void stats_add( std::atomic<uint64_t> &counter, uint64_t n ) noexcept
+{
+	counter.store( counter.load( std::memory_order_relaxed ) + n, std::memory_order_relaxed );
+}
+
+inline uint64_t stats_ticks() noexcept
+{
+#if defined(_MSC_VER) && ( defined(_M_X64) || defined(_M_IX86) ) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return uint64_t( std::chrono::steady_clock::now().time_since_epoch().count() );
+#endif
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/* Tables outlive their threads and get handed to the next new thread, so counts survive short-lived workers */
+struct stats_registry
+{
+	std::mutex lock;
+	std::vector<std::unique_ptr<stats_table>> tables;
+
+	static stats_registry &instance()
+	{
+		// Never destroyed, threads may still format during static destruction
+		static auto *registry = new stats_registry;
+		return *registry;
+	}
+
+	stats_table *acquire()
+	{
+		std::lock_guard<std::mutex> guard( lock );
+
+		for ( auto &table : tables )
+		{
+			if ( bool expected = false; table->in_use.compare_exchange_strong( expected, true, std::memory_order_acquire ) )
+				return table.get();
+		}
+
+		tables.push_back( std::make_unique<stats_table>() );
+		tables.back()->in_use.store( true, std::memory_order_relaxed );
+		return tables.back().get();
+	}
+};
+
+struct stats_thread
+{
+	stats_table *table = stats_registry::instance().acquire();
+	~stats_thread() { table->in_use.store( false, std::memory_order_release ); }
+};
+
+inline stats_table &thread_stats()
+{
+	thread_local stats_thread state;
+	return *state.table;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+/* Format strings are told apart by address, which is stable for literals and checked format strings */
+template <typename C>
+inline stats_entry &stats_lookup( const C *formatStr, size_t formatStrLen ) noexcept
+{
+	auto &table = thread_stats();
+	auto hash = size_t( ( uint64_t( uintptr_t( formatStr ) ) * 0x9E3779B97F4A7C15ull ) >> 32 );
+
+	for ( size_t probe = 0; probe < StatsTableSize; ++probe )
+	{
+		auto &entry = table.entries[( hash + probe ) % StatsTableSize];
+		const void *key = entry.key.load( std::memory_order_relaxed );
+
+		if ( key == formatStr )
+			return entry;
+
+		if ( !key )
+		{
+			// Copy the text now, a runtime format string may be gone by the time stats are collected
+			auto *end = transcode( formatStr, formatStrLen, entry.text, entry.text + StatsTextLength - 1 );
+			*end = 0;
+
+			entry.key.store( formatStr, std::memory_order_release );
+			return entry;
+		}
+	}
+
+	return table.other;
+}
+
+/* Measures one format call, see format_to_() */
+struct stats_scope
+{
+	stats_entry &entry;
+	size_t start_length;
+	uint64_t start = 0;
+	bool sampled;
+
+	template <typename C>
+	stats_scope( const C *formatStr, size_t formatStrLen, size_t outputLength ) noexcept
+		: entry( stats_lookup( formatStr, formatStrLen ) )
+		, start_length( outputLength )
+		, sampled( ( entry.calls.load( std::memory_order_relaxed ) & ( UFMT_STATS_SAMPLE_RATE - 1 ) ) == 0 )
+	{
+		if ( sampled )
+			start = stats_ticks();
+	}
+
+	void record( size_t outputLength, bool truncated ) noexcept
+	{
+		if ( sampled )
+		{
+			auto bucket = size_t( std::bit_width( stats_ticks() - start ) );
+			stats_add( entry.histogram[( bucket < StatsHistogramSize ) ? bucket : StatsHistogramSize - 1], 1 );
+			stats_add( entry.samples, 1 );
+		}
+
+		stats_add( entry.calls, 1 );
+		stats_add( entry.bytes, outputLength - start_length );
+
+		if ( truncated )
+			stats_add( entry.truncations, 1 );
+	}
+};
+
+} // namespace ufmt::detail
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace ufmt {
+
+/* Totals of one format string over all threads */
+struct format_stats
+{
+	std::string format;
+	uint64_t calls = 0;
+	uint64_t bytes = 0;
+	uint64_t truncations = 0;
+	uint64_t samples = 0;
+	uint64_t histogram[detail::StatsHistogramSize] = { };
+
+	/* Upper bound in ticks of the bucket holding the given fraction of the timed calls, e.g. 0.99 */
+	uint64_t percentile( double fraction ) const noexcept
+	{
+		auto wanted = uint64_t( double( samples ) * fraction );
+		uint64_t seen = 0;
+
+		for ( size_t i = 0; i < detail::StatsHistogramSize; ++i )
+		{
+			seen += histogram[i];
+			if ( seen > wanted || seen == samples )
+				return ( uint64_t( 1 ) << i ) - 1;
+		}
+
+		return 0;
+	}
+};
+
+/*
+ * Per format string counters, recorded by every format call when UFMT_STATS is defined:
+ *
+ *   #define UFMT_STATS
+ *   #include <ufmt/ufmt.hpp>
+ *   ...
+ *   fputs( ufmt::dump_format_stats().c_str(), stderr );
+ *
+ * Each thread counts into its own table without locks or read-modify-write atomics, collecting only reads them.
+ * Latency is sampled in ticks of the CPU timestamp counter, or steady_clock where there is none.
+ */
+inline std::vector<format_stats> collect_format_stats()
+{
+	auto &registry = detail::stats_registry::instance();
+	std::lock_guard<std::mutex> guard( registry.lock );
+
+	std::vector<format_stats> result;
+
+	auto merge = [&]( const detail::stats_entry &entry, const char *text )
+	{
+		auto calls = entry.calls.load( std::memory_order_relaxed );
+		if ( !calls )
+			return;
+
+		// The same format string shows up once per thread that used it
+		auto it = std::find_if( result.begin(), result.end(), [&]( const format_stats &s ) { return s.format == text; } );
+		if ( it == result.end() )
+			it = result.insert( result.end(), format_stats { text } );
+
+		it->calls += calls;
+		it->bytes += entry.bytes.load( std::memory_order_relaxed );
+		it->truncations += entry.truncations.load( std::memory_order_relaxed );
+		it->samples += entry.samples.load( std::memory_order_relaxed );
+
+		for ( size_t i = 0; i < detail::StatsHistogramSize; ++i )
+			it->histogram[i] += entry.histogram[i].load( std::memory_order_relaxed );
+	};
+
+	for ( auto &table : registry.tables )
+	{
+		for ( auto &entry : table->entries )
+		{
+			if ( entry.key.load( std::memory_order_acquire ) )
+				merge( entry, entry.text );
+		}
+
+		merge( table->other, "<other>" );
+	}
+
+	std::sort( result.begin(), result.end(), []( const format_stats &a, const format_stats &b ) { return a.calls > b.calls; } );
+	return result;
+}
+
+/* Zeroes the counters, calls racing with this on other threads may keep part of their old counts */
+inline void reset_format_stats()
+{
+	auto &registry = detail::stats_registry::instance();
+	std::lock_guard<std::mutex> guard( registry.lock );
+
+	auto clear = []( detail::stats_entry &entry )
+	{
+		entry.calls.store( 0, std::memory_order_relaxed );
+		entry.bytes.store( 0, std::memory_order_relaxed );
+		entry.truncations.store( 0, std::memory_order_relaxed );
+		entry.samples.store( 0, std::memory_order_relaxed );
+
+		for ( auto &bucket : entry.histogram )
+			bucket.store( 0, std::memory_order_relaxed );
+	};
+
+	for ( auto &table : registry.tables )
+	{
+		for ( auto &entry : table->entries )
+			clear( entry );
+
+		clear( table->other );
+	}
+}
+
+/* Text table of collect_format_stats(), busiest format strings first */
+inline std::string dump_format_stats()
+{
+	std::string result = "     calls        bytes  truncated  p50 ticks  p99 ticks  format\n";
+
+	auto column = [&]( uint64_t value, size_t width )
+	{
+		char digits[24];
+		auto *end = digits + sizeof( digits );
+		auto *begin = detail::uint_to_dec( value, end );
+
+		if ( size_t len = size_t( end - begin ); len < width )
+			result.append( width - len, ' ' );
+
+		result.append( begin, end );
+		result += "  ";
+	};
+
+	for ( auto &stats : collect_format_stats() )
+	{
+		column( stats.calls, 10 );
+		column( stats.bytes, 11 );
+		column( stats.truncations, 9 );
+		column( stats.percentile( 0.50 ), 9 );
+		column( stats.percentile( 0.99 ), 9 );
+
+		// Keep one line per entry
+		for ( char ch : stats.format )
+		{
+			switch ( ch )
+			{
+				case '\n': result += "\\n"; break;
+				case '\r': result += "\\r"; break;
+				case '\t': result += "\\t"; break;
+				default: result += ch; break;
+			}
+		}
+
+		result += '\n';
+	}
+
+	return result;
+}
+
+} // namespace ufmt
@@ -2,6 +2,8 @@
 
 #include "ufmt_base.hpp"
 
+#include <string.h>
+
 namespace ufmt::detail {
 
 template <typename T>
@@ -11,96 +13,192 @@ struct buffer_writer
 
 	T *end = begin;
 
-	T *cursor = begin;
+	// Keeps counting past the end, an index rather than a pointer so constant evaluation can overflow too
+	size_t count = 0;
+
+	constexpr size_t capacity() const noexcept { return size_t( end - begin ); }
 
-	size_t length() const noexcept { return size_t( cursor - begin ); }
+	constexpr size_t length() const noexcept { return count; }
 
-	size_t remaining() const noexcept { return size_t( ( cursor < end ) ? ( end - cursor ) : 0 ); }
+	constexpr size_t remaining() const noexcept { return ( count < capacity() ) ? ( capacity() - count ) : 0; }
 
-	bool remaining( size_t numBytes ) const noexcept { return cursor + numBytes <= end; }
+	constexpr bool remaining( size_t numBytes ) const noexcept { return count + numBytes <= capacity(); }
+
+	constexpr size_t code_points( size_t pos ) const noexcept
+	{
+		if ( pos >= capacity() )
+			return count - pos;
+
+		// Units that did not fit were never written, count them as-is
+		auto written = ( count < capacity() ) ? count : capacity();
+		return detail::count_code_points( begin + pos, written - pos ) + ( count - written );
+	}
 
 	template <typename U>
-	bool append( const U *str, size_t len = size_t( -1 ), size_t repeat = 1 )
+	constexpr bool append( const U *str, size_t len = size_t( -1 ), size_t repeat = 1 )
 	{
 		if ( !ufmt::length( str, len ) )
 			return true;
 
-		if ( !remaining( len * repeat ) )
+		// Same-width text that fits, by far the most common case, is one copy
+		if constexpr ( sizeof( U ) == sizeof( T ) )
 		{
-			auto *c = cursor;
-			cursor += len * repeat;
-
-			while ( repeat-- )
+			if ( repeat == 1 && remaining( len ) && !std::is_constant_evaluated() )
 			{
-				auto *in = str;
-				auto l = len;
-
-				while ( ( c < end ) && l-- )
-					*c++ = T( *in++ );
+				memcpy( begin + count, str, len * sizeof( T ) );
+				count += len;
+				return true;
 			}
-
-			return false;
 		}
 
+		auto numChars = detail::transcoded_length<T>( str, len );
+		bool result = remaining( numChars * repeat );
+
+		// Count always advances by the full length, so overflowing writes still report the required size
 		while ( repeat-- )
 		{
-			auto *in = str;
-			auto l = len;
+			if ( count < capacity() )
+				fill_gap( detail::transcode( str, len, begin + count, end ), count + numChars );
 
-			while ( l-- )
-				*cursor++ = T( *in++ );
+			count += numChars;
 		}
 
-		return true;
+		return result;
 	}
 
 	template <typename U>
-	bool insert( size_t pos, const U *str, size_t len = size_t( -1 ), size_t repeat = 1 )
+	constexpr bool insert( size_t pos, const U *str, size_t len = size_t( -1 ), size_t repeat = 1 )
 	{
 		if ( !ufmt::length( str, len ) )
 			return true;
 
-		bool result = true;
+		auto numChars = detail::transcoded_length<T>( str, len );
+		auto totalChars = numChars * repeat;
+
+		if ( count + totalChars <= capacity() && !std::is_constant_evaluated() )
+			memmove( begin + pos + totalChars, begin + pos, ( count - pos ) * sizeof( T ) );
+		else
+		{
+			// Shift the tail right, characters pushed past the end are dropped
+			auto written = ( count < capacity() ) ? count : capacity();
+			auto keep = ( totalChars < capacity() ) ? capacity() - totalChars : 0;
+
+			// Along with the rest of a code point cut at the end, its slots are zeroed like in fill_gap
+			if ( keep > pos && keep < written )
+				keep = pos + detail::code_point_cut( begin + pos, keep - pos );
+
+			for ( auto src = written; src > pos; )
+			{
+				--src;
 
-		auto charsToCopy = len * repeat;
-		if ( auto rem = remaining(); charsToCopy > rem )
+				if ( auto dst = src + totalChars; dst < capacity() )
+					begin[dst] = ( src < keep ) ? begin[src] : T( 0 );
+			}
+		}
+
+		count += totalChars;
+
+		for ( auto at = pos; repeat--; at += numChars )
 		{
-			charsToCopy = rem;
-			result = false;
+			if ( at < capacity() )
+				fill_gap( detail::transcode( str, len, begin + at, end ), at + numChars );
 		}
 
-		for ( size_t i = charsToCopy, j = len * repeat - 1, k = 1; i--; --j, ++k )
-			*( cursor + j ) = *( cursor - k );
+		return count <= capacity();
+	}
+
+	// A code point that did not fit in full is dropped, keep its slot zeroed
+	constexpr void fill_gap( T *written, size_t expectedEnd ) noexcept
+	{
+		while ( written < end && size_t( written - begin ) < expectedEnd )
+			*written++ = 0;
+	}
+
+	constexpr bool overflow() const noexcept { return count > capacity(); }
 
-		cursor += len * repeat;
+	constexpr void truncate( size_t len ) noexcept { count = len; }
+
+	constexpr void zero_terminate()
+	{
+		// A full buffer gives up its last unit, and the code point that unit belonged to
+		if ( begin < end )
+			begin[( count < capacity() ) ? count : detail::code_point_cut( begin, capacity() - 1 )] = 0;
+	}
+
+	constexpr buffer_writer( T *buffer, size_t len )
+		: begin( buffer )
+		, end( buffer ? ( buffer + len ) : nullptr )
+	{
+
+	}
+};
+
+/* Writes without bounds checks, only for outputs already sized for the longest possible result */
+template <typename T>
+struct unchecked_writer
+{
+	T *begin = nullptr;
+
+	size_t count = 0;
+
+	constexpr size_t length() const noexcept { return count; }
+	constexpr size_t remaining() const noexcept { return size_t( -1 ); }
+	constexpr bool remaining( size_t numBytes ) const noexcept { return true; }
+
+	constexpr size_t code_points( size_t pos ) const noexcept
+	{
+		return detail::count_code_points( begin + pos, count - pos );
+	}
+
+	template <typename U>
+	constexpr bool append( const U *str, size_t len = size_t( -1 ), size_t repeat = 1 )
+	{
+		if ( !ufmt::length( str, len ) )
+			return true;
+
+		auto numChars = detail::transcoded_length<T>( str, len );
 
 		while ( repeat-- )
 		{
-			auto *in = str;
-			auto l = len;
-
-			while ( l-- )
-				begin[pos++] = T( *in++ );
+			detail::transcode( str, len, begin + count, begin + count + numChars );
+			count += numChars;
 		}
 
-		return result;
+		return true;
 	}
 
-	void zero_terminate()
+	template <typename U>
+	constexpr bool insert( size_t pos, const U *str, size_t len = size_t( -1 ), size_t repeat = 1 )
 	{
-		if ( begin < end )
+		if ( !ufmt::length( str, len ) )
+			return true;
+
+		auto numChars = detail::transcoded_length<T>( str, len );
+		auto totalChars = numChars * repeat;
+
+		if ( std::is_constant_evaluated() )
 		{
-			if ( cursor < end )
-				( *cursor ) = 0;
-			else
-				end[-1] = 0;
+			for ( auto src = count; src > pos; --src )
+				begin[src - 1 + totalChars] = begin[src - 1];
 		}
+		else
+			memmove( begin + pos + totalChars, begin + pos, ( count - pos ) * sizeof( T ) );
+
+		for ( auto *at = begin + pos; repeat--; at += numChars )
+			detail::transcode( str, len, at, at + numChars );
+
+		count += totalChars;
+		return true;
 	}
 
-	buffer_writer( T *buffer, size_t len )
+	constexpr bool overflow() const noexcept { return false; }
+
+	constexpr void truncate( size_t len ) noexcept { count = len; }
+
+	constexpr void zero_terminate() { begin[count] = 0; }
+
+	constexpr unchecked_writer( T *buffer )
 		: begin( buffer )
-		, end( buffer ? ( buffer + len ) : nullptr )
-		, cursor( begin )
 	{
 
 	}
@@ -115,6 +213,11 @@ struct string_writer
 	size_t remaining() const noexcept { return size_t( -1 ); }
 	bool remaining( size_t numBytes ) const noexcept { return true; }
 
+	size_t code_points( size_t pos ) const noexcept
+	{
+		return detail::count_code_points( ufmt::data( output ) + pos, ufmt::length( output ) - pos );
+	}
+
 	template <typename U>
 	bool append( const U *str, size_t len = size_t( -1 ), size_t repeat = 1 )
 	{
@@ -128,10 +231,12 @@ struct string_writer
 		}
 		else
 		{
-			auto convertedStr = ufmt::convert<C>( str, len );
+			// Transcode straight into the output, no temporary string
+			auto numChars = detail::transcoded_length<C>( str, len );
+			auto *out = ufmt::make_room( output, ufmt::length( output ), numChars * repeat );
 
 			while ( repeat-- )
-				ufmt::append( output, convertedStr );
+				out = detail::transcode( str, len, out, out + numChars );
 		}
 
 		return true;
@@ -143,14 +248,19 @@ struct string_writer
 		if ( !ufmt::length( str, len ) )
 			return true;
 
-		auto convertedStr = ufmt::convert<C>( str, len );
+		auto numChars = detail::transcoded_length<C>( str, len );
+		auto *out = ufmt::make_room( output, pos, numChars * repeat );
 
 		while ( repeat-- )
-			ufmt::insert( output, pos, convertedStr );
+			out = detail::transcode( str, len, out, out + numChars );
 
 		return true;
 	}
 
+	bool overflow() const noexcept { return false; }
+
+	void truncate( size_t len ) { output.resize( len ); }
+
 	void zero_terminate()
 	{
 
@@ -163,18 +273,121 @@ struct string_writer
 	}
 };
 
+/* Measures output without storing it, used to size a destination before formatting into it */
+template <typename T>
+struct counting_writer
+{
+	size_t count = 0;
+
+	size_t points = 0;
+
+	// Alignment asks for code points written since its last length() call
+	mutable size_t mark_count = 0;
+
+	mutable size_t mark_points = 0;
+
+	size_t length() const noexcept
+	{
+		mark_count = count;
+		mark_points = points;
+		return count;
+	}
+
+	size_t remaining() const noexcept { return size_t( -1 ); }
+	bool remaining( size_t numBytes ) const noexcept { return true; }
+
+	size_t code_points( size_t pos ) const noexcept
+	{
+		return ( pos == mark_count ) ? ( points - mark_points ) : ( count - pos );
+	}
+
+	template <typename U>
+	bool append( const U *str, size_t len = size_t( -1 ), size_t repeat = 1 )
+	{
+		if ( !ufmt::length( str, len ) )
+			return true;
+
+		count += detail::transcoded_length<T>( str, len ) * repeat;
+		points += detail::count_code_points( str, len ) * repeat;
+		return true;
+	}
+
+	template <typename U>
+	bool insert( size_t /*pos*/, const U *str, size_t len = size_t( -1 ), size_t repeat = 1 )
+	{
+		return append( str, len, repeat );
+	}
+
+	bool overflow() const noexcept { return false; }
+
+	void truncate( size_t len ) noexcept { count = len; }
+
+	void zero_terminate()
+	{
+
+	}
+};
+
+/* Forwards to a writer owned by the caller, so formatting can continue where it left off */
+template <typename W>
+struct writer_ref
+{
+	W &target;
+
+	size_t length() const noexcept { return target.length(); }
+	size_t remaining() const noexcept { return target.remaining(); }
+	bool remaining( size_t numBytes ) const noexcept { return target.remaining( numBytes ); }
+	size_t code_points( size_t pos ) const noexcept { return target.code_points( pos ); }
+
+	template <typename U>
+	bool append( const U *str, size_t len = size_t( -1 ), size_t repeat = 1 ) { return target.append( str, len, repeat ); }
+
+	template <typename U>
+	bool insert( size_t pos, const U *str, size_t len = size_t( -1 ), size_t repeat = 1 )
+	{
+		return target.insert( pos, str, len, repeat );
+	}
+
+	bool overflow() const noexcept { return target.overflow(); }
+
+	void truncate( size_t len ) { target.truncate( len ); }
+
+	void zero_terminate() { target.zero_terminate(); }
+
+	writer_ref( W &w ) : target( w ) { }
+};
+
 template <typename T> struct writer { };
 
+template <typename T> struct writer<buffer_writer<T>> : writer_ref<buffer_writer<T>>
+{
+	writer( buffer_writer<T> &w ) : writer_ref<buffer_writer<T>>( w ) { }
+};
+
+template <typename T> struct writer<counting_writer<T>> : writer_ref<counting_writer<T>>
+{
+	writer( counting_writer<T> &w ) : writer_ref<counting_writer<T>>( w ) { }
+};
+
 template <typename T, size_t N>
 struct writer<T[N]> : buffer_writer<T>
 {
-	writer( T *buffer ) : buffer_writer<T>( buffer, N ) { }
+	constexpr writer( T *buffer ) : buffer_writer<T>( buffer, N ) { }
+};
+
+#if !defined(UFMT_DO_NOT_USE_STL)
+template <typename T, size_t N>
+struct writer<std::array<T, N>> : buffer_writer<T>
+{
+	constexpr writer( std::array<T, N> &buffer ) : buffer_writer<T>( buffer.data(), N ) { }
 };
+#endif
 
 #if !defined(UFMT_DO_NOT_USE_STL)
-template <typename C> struct writer<std::basic_string<C>> : string_writer<std::basic_string<C>, C>
+template <typename C, typename Tr, typename A>
+struct writer<std::basic_string<C, Tr, A>> : string_writer<std::basic_string<C, Tr, A>, C>
 {
-	writer( std::basic_string<C> &str ) : string_writer<std::basic_string<C>, C>( str ) { }
+	writer( std::basic_string<C, Tr, A> &str ) : string_writer<std::basic_string<C, Tr, A>, C>( str ) { }
 };
 #endif
 
@@ -1,8 +1,26 @@
 #include <ufmt/ufmt.hpp>
+#include <ufmt/ufmt_batch.hpp>
+#include <ufmt/ufmt_bytes.hpp>
+#include <ufmt/ufmt_chrono.hpp>
+#include <ufmt/ufmt_iovec.hpp>
+#include <ufmt/ufmt_json.hpp>
+#include <ufmt/ufmt_log.hpp>
+#include <ufmt/ufmt_mmap.hpp>
+#include <ufmt/ufmt_scan.hpp>
+#include <ufmt/ufmt_parallel.hpp>
 
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <charconv>
 #include <chrono>
+#include <filesystem>
 #include <format>
 #include <iostream>
+#include <memory_resource>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -11,12 +29,19 @@
 struct Stopwatch
 {
 	std::string name = "";
+	size_t numItems = 0;
+	const char *itemName = "items";
 	std::chrono::nanoseconds start = std::chrono::high_resolution_clock::now().time_since_epoch();
 
 	~Stopwatch()
 	{
 		auto duration = std::chrono::high_resolution_clock::now().time_since_epoch() - start;
-		std::cout << name << ": " << duration.count() / 1000000 << " ms" << std::endl;
+		std::cout << name << ": " << duration.count() / 1000000 << " ms";
+
+		if ( numItems && duration.count() )
+			std::cout << " (" << double( numItems ) * 1000.0 / double( duration.count() ) << " M " << itemName << "/s)";
+
+		std::cout << std::endl;
 	}
 };
 
@@ -27,10 +52,10 @@ void TestEqualFormat( const char *f, Args &&... args )
 {
 	char buff[256] = { };
 
-	auto ufmtResult = ufmt::format( f, args... );
-	auto formatResult = std::format( f, args... );
+	auto ufmtResult = ufmt::format( ufmt::runtime( f ), args... );
+	auto formatResult = std::vformat( f, std::make_format_args( args... ) );
 
-	ufmt::format_to( buff, f, args... );
+	ufmt::format_to( buff, ufmt::runtime( f ), args... );
 
 	if ( std::string( buff ) == formatResult && ufmtResult == formatResult )
 	{
@@ -61,7 +86,7 @@ void TestPerformance( const char *f, Args &&... args )
 
 		for ( size_t i = 0; i < NumIterations; ++i )
 		{
-			auto ufmtResult = ufmt::format( f, args... );
+			auto ufmtResult = ufmt::format( ufmt::runtime( f ), args... );
 			numCharsGenerated += ufmtResult.size();
 		}
 	}
@@ -74,7 +99,7 @@ void TestPerformance( const char *f, Args &&... args )
 
 		for ( size_t i = 0; i < NumIterations; ++i )
 		{
-			auto ufmtResult = std::format( f, args... );
+			auto ufmtResult = std::vformat( f, std::make_format_args( args... ) );
 			numCharsGenerated += ufmtResult.size();
 		}
 	}
@@ -84,6 +109,923 @@ void TestPerformance( const char *f, Args &&... args )
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void TestBatchPerformance()
+{
+	constexpr size_t NumRows = 1000000;
+
+	printf( "Batch performance test: %d rows\n", int( NumRows ) );
+
+	std::vector<int32_t> ids( NumRows );
+	std::vector<double> values( NumRows );
+	std::vector<uint64_t> counters( NumRows );
+
+	for ( size_t i = 0; i < NumRows; ++i )
+	{
+		ids[i] = int32_t( i ) - 1000;
+		values[i] = double( i ) * 0.125;
+		counters[i] = uint64_t( i ) * 2654435761ull;
+	}
+
+	std::string perCell, batch;
+
+	{
+		Stopwatch sw{ "per-cell time", NumRows, "rows" };
+
+		for ( size_t i = 0; i < NumRows; ++i )
+		{
+			ufmt::format_to( perCell, "{}", ids[i] );
+			perCell += ',';
+			ufmt::format_to( perCell, "{:.3f}", values[i] );
+			perCell += ',';
+			ufmt::format_to( perCell, "{}", counters[i] );
+			perCell += '\n';
+		}
+	}
+
+	{
+		Stopwatch sw{ "   batch time", NumRows, "rows" };
+		ufmt::format_rows_to( batch, "{},{:.3f},{}\n", NumRows, ids.data(), values.data(), counters.data() );
+	}
+
+	printf( batch == perCell ? " equal: %d bytes\n" : " ERROR: %d bytes differ\n", int( batch.size() ) );
+}
+
+void TestBatchFormat()
+{
+	const int values[] = { 42, -7, 1000000 };
+	const double reals[] = { 0.5, -1.25, 1e6 };
+
+	auto compare = [&]( const std::string &rowFormat )
+	{
+		std::string perRow, batch;
+		for ( size_t i = 0; i < std::size( values ); ++i )
+			ufmt::format_to( perRow, ufmt::runtime( rowFormat ), values[i], reals[i] );
+
+		ufmt::format_rows_to( batch, rowFormat, std::size( values ), values, reals );
+
+		if ( batch == perRow )
+			printf( " equal: %d bytes\n", int( batch.size() ) );
+		else
+			printf( " ERROR: batch = \"%s\"\n        format = \"%s\"\n", batch.c_str(), perRow.c_str() );
+	};
+
+	// Row templates with more fields than a default parsed_format holds keep their tail
+	std::string rowFormat;
+	for ( int i = 0; i < 35; ++i )
+		rowFormat += "{0},";
+	rowFormat += "END{1}\n";
+
+	compare( rowFormat );
+
+	// Padded cells align as ufmt::format aligns them, numbers to the right by default
+	compare( "{0:8}|{0:<8}|{0:^8}|{0:08}|{0:+}|{1:10}|{1:<10.2f}\n" );
+
+	// Text already in the output does not count towards the first row when sizing the rest
+	std::string prefilled( 1 << 20, '#' );
+	std::vector<int> zeros( 100000 );
+	ufmt::format_rows_to( prefilled, "{}\n", zeros.size(), zeros.data() );
+	assert( prefilled.size() == ( 1 << 20 ) + 2 * zeros.size() && prefilled.capacity() < ( 4 << 20 ) );
+
+#if defined(__SIZEOF_INT128__)
+	// 128-bit columns take the plain decimal path too, with all 39 digits
+	using int128 = ufmt::detail::int128_t;
+	using uint128 = ufmt::detail::uint128_t;
+
+	const int128 wide[] = { int128( 1 ) << 127, -1, ~( int128( 1 ) << 127 ) };
+	const uint128 wideUnsigned[] = { ~uint128( 0 ), 0, uint128( 1 ) << 64 };
+
+	std::string perRow, batch;
+	for ( size_t i = 0; i < std::size( wide ); ++i )
+		ufmt::format_to( perRow, "{},{}\n", wide[i], wideUnsigned[i] );
+
+	ufmt::format_rows_to( batch, "{},{}\n", std::size( wide ), wide, wideUnsigned );
+
+	if ( batch == perRow && batch.starts_with( "-170141183460469231731687303715884105728,340282366920938463463374607431768211455\n" ) )
+		printf( " equal: %d bytes\n", int( batch.size() ) );
+	else
+		printf( " ERROR: batch = \"%s\"\n", batch.c_str() );
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TestHexFormat()
+{
+	const uint8_t bytes[] = { 0x00, 0x7F, 0x80, 0xAB, 'h', 'i', 0xFF, 0x10, 0x20, 0x30, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x0A, 0xCD };
+
+	assert( ufmt::format( "{}", std::span( bytes, 4 ) ) == "007f80ab" );
+	assert( ufmt::format( "{:#X}", std::span( bytes, 4 ) ) == "0X007F80AB" );
+	assert( ufmt::format( "{}", ufmt::hex( std::span( bytes, 5 ), ':' ) ) == "00:7f:80:ab:68" );
+	assert( ufmt::format( "{:X}", ufmt::hex( std::span( bytes, 5 ), ' ', 2 ) ) == "007F 80AB 68" );
+
+	// Full line, then a short one with the hex column padded to keep the ASCII column in place
+	assert( ufmt::format( "{}", ufmt::hexdump( bytes, 0x1000 ) ) ==
+	        "00001000  00 7f 80 ab 68 69 ff 10  20 30 41 42 43 44 45 46  |....hi.. 0ABCDEF|\n"
+	        "00001010  0a cd                                             |..|" );
+
+	// Long spans go through the vector path in chunks, the result must match byte at a time formatting
+	std::vector<uint8_t> large( 4099 );
+	for ( size_t i = 0; i < large.size(); ++i )
+		large[i] = uint8_t( i * 2654435761u >> 13 );
+
+	std::string perByte;
+	for ( auto b : large )
+		ufmt::format_to( perByte, "{:02X}", b );
+
+	assert( ufmt::format( "{:X}", std::span( large ) ) == perByte );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TestTranscodeFormat()
+{
+	// Every pairing of code unit widths: U+263A takes three UTF-8 units, U+1F600 four and a UTF-16 surrogate pair
+	assert( ufmt::format( "{} {} {}", L"\u263A", u"\U0001F600", U"x\u263A" ) == "\xE2\x98\xBA \xF0\x9F\x98\x80 x\xE2\x98\xBA" );
+	assert( ufmt::format( L"{}|{:>3}", "\xE2\x98\xBA", u"\U0001F600" ) == L"\u263A|  \U0001F600" );
+	assert( ufmt::format( ufmt::runtime( u"{} {:*<3}" ), "\xF0\x9F\x98\x80", U"\u263A" ) == u"\U0001F600 \u263A**" );
+	assert( ufmt::format( ufmt::runtime( U"{}{}" ), u"\U0001F600", L"\u263A" ) == U"\U0001F600\u263A" );
+
+	// Bounded outputs never end in part of a code point, the slots it would have taken are zeroed
+	char padded[8];
+	ufmt::format_to( padded, "{:>5}", L"\u263A\u263A" );
+	assert( memcmp( padded, "   \xE2\x98\xBA\0\0", sizeof( padded ) ) == 0 );
+
+	char terminated[5];
+	ufmt::format_to0( terminated, "{}", "ab\xE2\x98\xBA" );
+	assert( std::string_view( terminated ) == "ab" );
+
+	char sameWidth[4];
+	ufmt::format_to( sameWidth, "{}", "ab\xE2\x98\xBA" );
+	assert( memcmp( sameWidth, "ab\0\0", sizeof( sameWidth ) ) == 0 );
+
+	char16_t pair[3];
+	ufmt::format_to0( pair, ufmt::runtime( u"a{}" ), u"\U0001F600" );
+	assert( std::u16string_view( pair ) == u"a" );
+
+	char16_t widened[3];
+	ufmt::format_to( widened, ufmt::runtime( u"{:>2}" ), "\xF0\x9F\x98\x80" );
+	assert( std::u16string_view( widened, 3 ) == std::u16string_view( u" \U0001F600", 3 ) );
+
+	wchar_t wide[4];
+	ufmt::format_to0( wide, L"{}{}", "\xE2\x98\xBA", U"\u263A\U0001F600!" );
+	assert( std::wstring_view( wide ) == ( sizeof( wchar_t ) == 2 ? L"\u263A\u263A" : L"\u263A\u263A\U0001F600" ) );
+
+	char32_t utf32[2];
+	ufmt::format_to( utf32, ufmt::runtime( U"{}" ), "\xF0\x9F\x98\x80\xE2\x98\xBA!" );
+	assert( utf32[0] == U'\U0001F600' && utf32[1] == U'\u263A' );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TestChronoFormat()
+{
+	using namespace std::chrono;
+
+	auto tp = sys_days( year( 2024 ) / February / 29 ) + hours( 13 ) + minutes( 45 ) + seconds( 7 ) + microseconds( 123456 );
+
+	// The second call hits the per-thread cache and only rewrites the sub-second digits
+	assert( ufmt::format( "{} message", tp ) == "2024-02-29 13:45:07.123456 message" );
+	assert( ufmt::format( "{} message", tp + microseconds( 1 ) ) == "2024-02-29 13:45:07.123457 message" );
+	assert( ufmt::format( "{:%a %b %e %j %I%p %u %y/%C}", time_point_cast<seconds>( tp ) ) == "Thu Feb 29 060 01PM 4 24/20" );
+
+	// Longer than the cached text, five sub-second fields included
+	std::string longSpec, expected;
+	for ( int i = 0; i < 5; ++i )
+	{
+		longSpec += "%A %B %d %S | ";
+		expected += "Thursday February 29 07.123456 | ";
+	}
+
+	assert( ufmt::format( ufmt::runtime( "{:" + longSpec + "}" ), tp ) == expected );
+	assert( ufmt::format( ufmt::runtime( "{:" + longSpec + "}" ), tp ) == expected );
+
+	// Wide specs are transcoded, not cut to their low byte
+	assert( ufmt::format( L"{:%H\u6642%M\u5206}", tp ) == L"13\u664245\u5206" );
+	assert( ufmt::format( ufmt::runtime( u"{:%d\U0001F600%m}" ), tp ) == u"29\U0001F60002" );
+
+	assert( ufmt::format( "{}", milliseconds( 42 ) ) == "42ms" );
+	assert( ufmt::format( "{:%H:%M}", minutes( -90 ) ) == "-01:30" );
+	assert( ufmt::format( "{:%Q%q %T}", milliseconds( 3723004 ) ) == "3723004ms 01:02:03.004" );
+
+	// The most negative count has no positive counterpart in its own type
+	assert( ufmt::format( "{}", nanoseconds::min() ) == "-9223372036854775808ns" );
+	assert( ufmt::format( "{:%T}", nanoseconds::min() ) == "-2562047:47:16.854775808" );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TestParallelFormat()
+{
+	constexpr size_t NumRecords = 50000;
+
+	auto record = [&]( auto &out, size_t i )
+	{
+		ufmt::format_to( out, "{:>6},{:.2f},{}\n", int( i ) - 100, double( i ) / 8, i % 3 ? "x" : "\xE2\x98\xBA" );
+	};
+
+	std::string serial = "header\n";
+	for ( size_t i = 0; i < NumRecords; ++i )
+		record( serial, i );
+
+	// Repeated calls share the worker threads, every split must match the serial loop
+	for ( size_t numThreads : { 2, 3, 8, 2 } )
+	{
+		std::string parallel = "header\n";
+		auto numChars = ufmt::format_many( parallel, NumRecords, record, numThreads );
+		assert( parallel == serial && numChars == serial.size() - 7 );
+	}
+
+	std::vector<char> bounded( serial.size() - 7 );
+	assert( ufmt::format_many_n( bounded.data(), bounded.size(), NumRecords, record, 4 ) == bounded.size() );
+	assert( std::string_view( bounded.data(), bounded.size() ) == std::string_view( serial ).substr( 7 ) );
+	assert( ufmt::format_many_n( bounded.data(), bounded.size() - 1, NumRecords, record, 4 ) == bounded.size() );
+
+	// A record failing while written leaves the output as it was
+	std::atomic<size_t> calls = 0;
+	std::string failed = "header\n";
+
+	try
+	{
+		ufmt::format_many( failed, NumRecords, [&]( auto &out, size_t i )
+		{
+			if ( i == NumRecords - 1 && calls++ )
+				throw std::runtime_error( "second pass" );
+
+			record( out, i );
+		}, 4 );
+
+		assert( false );
+	}
+	catch ( const std::runtime_error & )
+	{
+		assert( failed == "header\n" && calls == 2 );
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TestParallelPerformance()
+{
+	constexpr size_t NumRecords = 1000000;
+
+	printf( "Parallel performance test: %d records\n", int( NumRecords ) );
+
+	std::vector<int32_t> ids( NumRecords );
+	std::vector<double> values( NumRecords );
+
+	for ( size_t i = 0; i < NumRecords; ++i )
+	{
+		ids[i] = int32_t( i ) - 1000;
+		values[i] = double( i ) * 0.125;
+	}
+
+	auto record = [&]( auto &out, size_t i )
+	{
+		ufmt::format_to( out, "{:>8},{:.3f},record {}\n", ids[i], values[i], i );
+	};
+
+	std::string serial, parallel;
+
+	{
+		Stopwatch sw{ " serial time", NumRecords, "records" };
+
+		for ( size_t i = 0; i < NumRecords; ++i )
+			record( serial, i );
+	}
+
+	for ( size_t numThreads = 1; numThreads <= std::thread::hardware_concurrency(); numThreads *= 2 )
+	{
+		char name[32];
+		snprintf( name, sizeof( name ), "%2d threads time", int( numThreads ) );
+
+		parallel.clear();
+
+		{
+			Stopwatch sw{ name, NumRecords, "records" };
+			ufmt::format_many( parallel, NumRecords, record, numThreads );
+		}
+
+		if ( parallel != serial )
+			printf( " ERROR: %d threads output differs\n", int( numThreads ) );
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TestIovecFormat()
+{
+	static constexpr const char Template[] =
+	    "HTTP/1.1 200 OK\r\n"
+	    "Server: ufmt\r\n"
+	    "Content-Type: application/json; charset=utf-8\r\n"
+	    "Content-Length: {}\r\n"
+	    "Connection: keep-alive\r\n"
+	    "X-Request-Id: {}\r\n\r\n";
+
+	auto joined = []( const auto &slices )
+	{
+		std::string result;
+		for ( size_t i = 0; i < slices.size(); ++i )
+			result.append( static_cast<const char *>( slices.data()[i].iov_base ), slices.data()[i].iov_len );
+
+		return result;
+	};
+
+	auto inTemplate = []( const ufmt::io_slice &slice )
+	{
+		auto *base = static_cast<const char *>( slice.iov_base );
+		return base >= Template && base + slice.iov_len <= Template + sizeof( Template );
+	};
+
+	// Long literals are referenced in place, arguments and the short tail literal share the scratch arena
+	ufmt::iovec_output<> slices;
+	ufmt::format_to( slices, Template, 1234, 987654321 );
+
+	assert( joined( slices ) == ufmt::format( Template, 1234, 987654321 ) && !slices.overflow() );
+	assert( slices.size() == 4 && slices.scratch_used == 4 + 9 + 4 );
+	assert( inTemplate( slices.data()[0] ) && inTemplate( slices.data()[2] ) );
+	assert( !inTemplate( slices.data()[1] ) && !inTemplate( slices.data()[3] ) );
+
+	// Short literals and padded fields coalesce into one scratch slice
+	slices.clear();
+	ufmt::format_to( slices, "id={:>6}|{:<3}|", 42, "ab" );
+	assert( joined( slices ) == "id=    42|ab |" && slices.size() == 1 );
+
+	// Running out of slices drops the rest and reports it
+	ufmt::iovec_output<2> few;
+	ufmt::format_to( few, Template, 1, 2 );
+	assert( few.overflow() && few.size() == 2 );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TestMmapPerformance()
+{
+	constexpr size_t NumRecords = 2000000;
+
+	printf( "Mmap log performance test: %d records\n", int( NumRecords ) );
+
+	auto fwritePath = ( std::filesystem::temp_directory_path() / "ufmt_fwrite.log" ).string();
+	auto mmapPath = ( std::filesystem::temp_directory_path() / "ufmt_mmap.log" ).string();
+
+	std::filesystem::remove( fwritePath );
+	std::filesystem::remove( mmapPath );
+
+	{
+		Stopwatch sw{ "fwrite time", NumRecords, "records" };
+
+		FILE *f = fopen( fwritePath.c_str(), "wb" );
+		std::string line;
+
+		for ( size_t i = 0; i < NumRecords; ++i )
+		{
+			line.clear();
+			ufmt::format_to( line, "{} INFO request {} served in {} us\n", uint64_t( 1700000000000 + i ), i, i % 977 );
+			fwrite( line.data(), 1, line.size(), f );
+		}
+
+		fclose( f );
+	}
+
+	{
+		Stopwatch sw{ "  mmap time", NumRecords, "records" };
+
+		ufmt::mmap_log log;
+		log.open( mmapPath.c_str() );
+
+		for ( size_t i = 0; i < NumRecords; ++i )
+			log.write( "{} INFO request {} served in {} us\n", uint64_t( 1700000000000 + i ), i, i % 977 );
+	}
+
+	auto fwriteSize = std::filesystem::file_size( fwritePath );
+	printf( fwriteSize == std::filesystem::file_size( mmapPath ) ? " equal: %d bytes\n" : " ERROR: %d bytes differ\n", int( fwriteSize ) );
+
+	std::filesystem::remove( fwritePath );
+	std::filesystem::remove( mmapPath );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TestScanPerformance()
+{
+	constexpr size_t NumLines = 1000000;
+
+	printf( "Scan performance test: %d lines\n", int( NumLines ) );
+
+	std::vector<std::string> lines( NumLines );
+	for ( size_t i = 0; i < NumLines; ++i )
+		lines[i] = ufmt::format( "{} {} {:.3f} user{}", int32_t( i ) - 5000, uint32_t( i * 2654435761u ), double( i ) * 0.125, i );
+
+	int64_t checksum[3] = { };
+
+	{
+		Stopwatch sw{ "    sscanf time", NumLines, "lines" };
+
+		for ( const auto &line : lines )
+		{
+			int a = 0;
+			unsigned b = 0;
+			double c = 0;
+			char name[32];
+
+			if ( sscanf( line.c_str(), "%d %u %lf %31s", &a, &b, &c, name ) == 4 )
+				checksum[0] += a + b + int64_t( c ) + name[4];
+		}
+	}
+
+	{
+		Stopwatch sw{ "from_chars time", NumLines, "lines" };
+
+		for ( const auto &line : lines )
+		{
+			int a = 0;
+			unsigned b = 0;
+			double c = 0;
+
+			const char *cursor = line.data(), *end = line.data() + line.size();
+			auto r1 = std::from_chars( cursor, end, a );
+			auto r2 = std::from_chars( r1.ptr + 1, end, b );
+			auto r3 = std::from_chars( r2.ptr + 1, end, c );
+
+			if ( r1.ec == std::errc() && r2.ec == std::errc() && r3.ec == std::errc() )
+				checksum[1] += a + b + int64_t( c ) + r3.ptr[5];
+		}
+	}
+
+	{
+		Stopwatch sw{ "      scan time", NumLines, "lines" };
+
+		for ( const auto &line : lines )
+		{
+			int a = 0;
+			unsigned b = 0;
+			double c = 0;
+			std::string_view name;
+
+			if ( ufmt::scan( line, "{} {} {} {}", a, b, c, name ) )
+				checksum[2] += a + b + int64_t( c ) + name[4];
+		}
+	}
+
+	printf( checksum[0] == checksum[1] && checksum[1] == checksum[2] ? " equal\n" : " ERROR: checksums differ\n" );
+}
+
+void TestScanFormat()
+{
+	double value = 0;
+	int count = 0;
+
+	// One sign per number, a doubled sign is a mismatch rather than a value
+	bool ok = ufmt::scan( "-5", "{}", value ) && value == -5.0 && ufmt::scan( "+2.5e1", "{}", value ) && value == 25.0;
+	ok = ok && !ufmt::scan( "--5", "{}", value ) && !ufmt::scan( "+-5", "{}", value ) && !ufmt::scan( "-+5", "{}", value );
+	ok = ok && !ufmt::scan( "--5", "{}", count );
+
+	printf( ok ? " equal\n" : " ERROR: signs scanned\n" );
+
+#if defined(__SIZEOF_INT128__)
+	// 128-bit integers take the same path, with overflow detected at their own limits
+	ufmt::detail::int128_t wide = 0;
+	ufmt::detail::uint128_t uwide = 0;
+
+	assert( ufmt::scan( "-170141183460469231731687303715884105728", "{}", wide ) && wide == ufmt::detail::int128_t( ~( ~ufmt::detail::uint128_t( 0 ) >> 1 ) ) );
+	assert( ufmt::scan( "ffffffffffffffffffffffffffffffff", "{:x}", uwide ) && uwide == ~ufmt::detail::uint128_t( 0 ) );
+	assert( !ufmt::scan( "170141183460469231731687303715884105728", "{}", wide ) && !ufmt::scan( "-1", "{}", uwide ) );
+#endif
+
+	// A width on a character spans the padded field the formatter writes
+	char first = 0, second = 0;
+	assert( ufmt::scan( "a  |  b|", "{:3}|{:3}|", first, second ) && first == 'a' && second == 'b' );
+	assert( ufmt::scan( ufmt::format( "{:<4}|{:>4}|", 'x', 'y' ), "{:4}|{:4}|", first, second ) && first == 'x' && second == 'y' );
+}
+
+void TestFixedStringPerformance()
+{
+	constexpr int NumRecords = 5000000;
+
+	printf( "Fixed string performance test: %d records\n", NumRecords );
+
+	size_t checksum[2] = { };
+
+	{
+		Stopwatch sw{ " format_to_n time", NumRecords, "records" };
+
+		char buff[64];
+		for ( int i = 0; i < NumRecords; ++i )
+			checksum[0] += ufmt::format_to_n( buff, sizeof( buff ), "id={} hash={:08x} ok={}", i, uint32_t( i * 2654435761u ), ( i & 1 ) != 0 );
+	}
+
+	{
+		Stopwatch sw{ "format<\"..\"> time", NumRecords, "records" };
+
+		for ( int i = 0; i < NumRecords; ++i )
+			checksum[1] += ufmt::format<"id={} hash={:08x} ok={}">( i, uint32_t( i * 2654435761u ), ( i & 1 ) != 0 ).size();
+	}
+
+	printf( checksum[0] == checksum[1] ? " equal\n" : " ERROR: checksums differ\n" );
+}
+
+template <ufmt::fixed_string Format, typename T>
+bool WithinCapacity( const T &value )
+{
+	auto result = ufmt::format<Format>( value );
+	return !result.truncated() && result.size() <= result.capacity();
+}
+
+template <typename T>
+bool IntegerBoundsHold( T value )
+{
+	return WithinCapacity<"{:#b}">( value ) && WithinCapacity<"{:#B}">( value ) && WithinCapacity<"{:+d}">( value ) &&
+	       WithinCapacity<"{:n}">( value ) && WithinCapacity<"{:#o}">( value ) && WithinCapacity<"{:#x}">( value ) &&
+	       WithinCapacity<"{:#X}">( value ) && WithinCapacity<"{:#a}">( value ) && WithinCapacity<"{:#e}">( value ) &&
+	       WithinCapacity<"{:#f}">( value );
+}
+
+template <typename T>
+bool FloatBoundsHold( T value )
+{
+	return WithinCapacity<"{:#a}">( value ) && WithinCapacity<"{:#A}">( value ) && WithinCapacity<"{:#.20a}">( value ) &&
+	       WithinCapacity<"{:#e}">( value ) && WithinCapacity<"{:#E}">( value ) && WithinCapacity<"{:#f}">( value ) &&
+	       WithinCapacity<"{:#F}">( value ) && WithinCapacity<"{:#g}">( value ) && WithinCapacity<"{:#G}">( value ) &&
+	       WithinCapacity<"{:#.17g}">( value ) && WithinCapacity<"{:n}">( value ) && WithinCapacity<"{:.3n}">( value ) &&
+	       WithinCapacity<"{:+}">( value ) && WithinCapacity<"{:#x}">( value );
+}
+
+void TestFixedStringBounds()
+{
+	// The capacity of format<"..."> is a bound, the extreme value of every presentation type has to fit it
+	bool ok = IntegerBoundsHold( std::numeric_limits<int64_t>::min() ) && IntegerBoundsHold( std::numeric_limits<uint64_t>::max() ) &&
+	          IntegerBoundsHold( std::numeric_limits<int8_t>::min() ) && IntegerBoundsHold( std::numeric_limits<unsigned short>::max() );
+#if defined(__SIZEOF_INT128__)
+	ok = ok && IntegerBoundsHold( ~ufmt::detail::uint128_t( 0 ) ) && IntegerBoundsHold( ufmt::detail::int128_t( 1 ) << 127 );
+#endif
+
+	for ( double value : { -std::numeric_limits<double>::max(), -std::numeric_limits<double>::min(),
+	                       -std::numeric_limits<double>::denorm_min(), -0.000123456789, -1e15 - 0.5 } )
+		ok = ok && FloatBoundsHold( value ) && FloatBoundsHold( float( value ) );
+
+	ok = ok && WithinCapacity<"{:?}">( '\x01' ) && WithinCapacity<"{:c}">( U'\U0010FFFF' ) && WithinCapacity<"{:#b}">( L'x' ) &&
+	     WithinCapacity<"{}">( false ) && WithinCapacity<"{}">( &ok ) && WithinCapacity<"{:?}">( "\x01\xFF" ) &&
+	     WithinCapacity<"{:j}">( "\"\x01" ) && WithinCapacity<"{:m}">( "\xFF\xFF" ) && WithinCapacity<"{:u}">( "\xFF" );
+
+	printf( ok ? " equal\n" : " ERROR: formatted past the fixed_string capacity\n" );
+}
+
+void TestJsonPerformance()
+{
+	constexpr int NumRecords = 2000000;
+
+	printf( "JSON escaping performance test: %d records\n", NumRecords );
+
+	const std::string messages[] = {
+		"connection accepted from 10.0.0.12 after 3 retries, handshake completed in 41 ms",
+		"user \"admin\" logged in from C:\\Users\\admin\\session.dat\n",
+		"short",
+	};
+
+	size_t checksum[3] = { };
+
+	{
+		Stopwatch sw{ "escape + format time", NumRecords, "records" };
+
+		std::string escaped, out;
+		for ( int i = 0; i < NumRecords; ++i )
+		{
+			// Byte at a time escaping into a scratch string, then formatting that
+			escaped.clear();
+			for ( char ch : messages[i % 3] )
+			{
+				switch ( ch )
+				{
+					case '"': escaped += "\\\""; break;
+					case '\\': escaped += "\\\\"; break;
+					case '\n': escaped += "\\n"; break;
+					default: escaped += ch; break;
+				}
+			}
+
+			out.clear();
+			ufmt::format_to( out, "{{\"id\":{},\"msg\":\"{}\"}}", i, escaped );
+			checksum[0] += out.size();
+		}
+	}
+
+	{
+		Stopwatch sw{ "{:j} time", NumRecords, "records" };
+
+		std::string out;
+		for ( int i = 0; i < NumRecords; ++i )
+		{
+			out.clear();
+			ufmt::format_to( out, "{{\"id\":{},\"msg\":{:j}}}", i, messages[i % 3] );
+			checksum[1] += out.size();
+		}
+	}
+
+	{
+		Stopwatch sw{ "json_object time", NumRecords, "records" };
+
+		std::string out;
+		for ( int i = 0; i < NumRecords; ++i )
+		{
+			out.clear();
+			ufmt::format_to( out, "{}", ufmt::json_object( "id", i, "msg", messages[i % 3] ) );
+			checksum[2] += out.size();
+		}
+	}
+
+	printf( checksum[0] == checksum[1] && checksum[1] == checksum[2] ? " equal\n" : " ERROR: checksums differ\n" );
+}
+
+void TestJsonFormat()
+{
+	int value = 0;
+	const int *none = nullptr;
+
+	// Null pointers are null, others the formatted address as a string
+	auto object = ufmt::format( "{}", ufmt::json_object( "none", none, "some", &value, "quote", '"' ) );
+	auto expected = ufmt::format( "{{\"none\":null,\"some\":\"{}\",\"quote\":\"\\\"\"}}", static_cast<const void *>( &value ) );
+
+	// Characters take the string escapes, also when the spec is only known at runtime
+	auto chars = ufmt::format( ufmt::runtime( "{:j} {:l} {:l} {:j}" ), '\n', 'a', ' ', L'\x01' );
+
+	if ( object == expected && chars == R"("\n" a " " "\u0001")" )
+		printf( " equal: %s\n", object.c_str() );
+	else
+		printf( " ERROR: %s %s\n", object.c_str(), chars.c_str() );
+}
+
+void TestDebugFormat()
+{
+	// Long clean runs, printable UTF-8 kept, C1 controls and broken sequences spelled out
+	std::string text( 40, 'a' );
+	text += "caf\xC3\xA9 \xC2\x85 \xE2\x98\xBA\t\"";
+
+	assert( ufmt::format( "{:?}", text ) == "\"" + std::string( 40, 'a' ) + "caf\xC3\xA9 \\u{85} \xE2\x98\xBA\\t\\\"\"" );
+	assert( ufmt::format( "{:?}", std::string_view( "\xC3(\xC3" ) ) == "\"\\x{c3}(\\x{c3}\"" );
+	assert( ufmt::format( "{:?}|{:s}", "x", "y" ) == "\"x\"|y" );
+}
+
+void TestDebugPerformance()
+{
+	constexpr int NumRecords = 5000000;
+
+	printf( "Debug string performance test: %d records\n", NumRecords );
+
+	const std::string input = "GET /api/v1/users?name=caf\xC3\xA9&limit=50 HTTP/1.1 from 10.0.0.12, agent curl/8.4.0";
+
+	size_t checksum[2] = { };
+
+	{
+		Stopwatch sw{ "{} time", NumRecords, "records" };
+
+		char buff[256];
+		for ( int i = 0; i < NumRecords; ++i )
+			checksum[0] += ufmt::format_to_n( buff, sizeof( buff ), "request {}", input );
+	}
+
+	{
+		Stopwatch sw{ "{:?} time", NumRecords, "records" };
+
+		char buff[256];
+		for ( int i = 0; i < NumRecords; ++i )
+			checksum[1] += ufmt::format_to_n( buff, sizeof( buff ), "request {:?}", input );
+	}
+
+	// Nothing to escape, only the quotes differ
+	printf( checksum[0] + 2 * size_t( NumRecords ) == checksum[1] ? " equal\n" : " ERROR: checksums differ\n" );
+}
+
+void TestLogFormat()
+{
+	static std::vector<std::pair<ufmt::log_level, std::string>> records;
+	ufmt::set_log_sink( []( ufmt::log_level level, const char *text, size_t length ) { records.emplace_back( level, std::string( text, length ) ); } );
+	ufmt::set_log_level( ufmt::log_level::info );
+
+	int evaluated = 0;
+	auto expensive = [&]( int i ) { ++evaluated; return std::to_string( i ); };
+
+	// Disabled statements skip their arguments, lazy ones included
+	for ( int i = 0; i < 3; ++i )
+	{
+		UFMT_LOG_DEBUG( "id={} state={}", i, ufmt::lazy( [&] { return expensive( i ); } ) );
+		UFMT_LOG_INFO( "id={} state={:>3}", i, ufmt::lazy( [&] { return expensive( i * 10 ); } ) );
+	}
+
+	UFMT_LOG( ufmt::log_level::error, "plain" );
+
+	assert( evaluated == 3 && records.size() == 4 );
+	assert( records[0].first == ufmt::log_level::info && records[0].second == "id=0 state=  0" );
+	assert( records[2].second == "id=2 state= 20" );
+	assert( records[3].first == ufmt::log_level::error && records[3].second == "plain" );
+
+	// The runtime threshold applies to the next statement
+	ufmt::set_log_level( ufmt::log_level::off );
+	UFMT_LOG_FATAL( "dropped {}", ufmt::lazy( [&] { return expensive( 0 ); } ) );
+	assert( evaluated == 3 && records.size() == 4 && !ufmt::log_enabled( ufmt::log_level::fatal ) );
+
+	ufmt::set_log_level( ufmt::log_level::info );
+	ufmt::set_log_sink( nullptr );
+}
+
+void TestGroupingPerformance()
+{
+	constexpr int NumRecords = 10000000;
+
+	printf( "Digit grouping performance test: %d records\n", NumRecords );
+
+	// Both sides hash the bytes they produced, so any difference in the grouped text shows
+	auto hash = []( uint64_t h, const char *str, size_t len )
+	{
+		for ( size_t i = 0; i < len; ++i )
+			h = ( h ^ uint8_t( str[i] ) ) * 1099511628211ull;
+
+		return h;
+	};
+
+	uint64_t checksum[2] = { 14695981039346656037ull, 14695981039346656037ull };
+
+	{
+		Stopwatch sw{ "{} + by hand time", NumRecords, "records" };
+
+		char buff[64], grouped[64];
+		for ( int i = 0; i < NumRecords; ++i )
+		{
+			auto len = ufmt::format_to_n( buff, sizeof( buff ), "{}", uint64_t( i ) * 1234567 );
+
+			// A comma before every group of three digits counted from the right
+			size_t numGrouped = 0;
+			for ( size_t j = 0; j < len; ++j )
+			{
+				if ( j && ( len - j ) % 3 == 0 )
+					grouped[numGrouped++] = ',';
+
+				grouped[numGrouped++] = buff[j];
+			}
+
+			checksum[0] = hash( checksum[0], grouped, numGrouped );
+		}
+	}
+
+	{
+		Stopwatch sw{ "        {:n} time", NumRecords, "records" };
+
+		char buff[64];
+		for ( int i = 0; i < NumRecords; ++i )
+		{
+			auto len = ufmt::format_to_n( buff, sizeof( buff ), "{:n}", uint64_t( i ) * 1234567 );
+			checksum[1] = hash( checksum[1], buff, len );
+		}
+	}
+
+	printf( checksum[0] == checksum[1] ? " equal\n" : " ERROR: checksums differ\n" );
+}
+
+void TestGroupingFormat()
+{
+	// Floats group in fixed notation, with the precision of the field or six digits
+	auto grouped = ufmt::format( "{:n} {:.2n} {:.1n} {:>14.1n}", 1234567.25, -9876543.219, 1e6, 12345.0 );
+
+	if ( grouped == "1,234,567.250000 -9,876,543.22 1,000,000.0       12,345.0" )
+		printf( " equal: \"%s\"\n", grouped.c_str() );
+	else
+		printf( " ERROR: \"%s\"\n", grouped.c_str() );
+
+	// Integers group as their digits are produced, whole groups, short leading groups and the widest values
+	assert( ufmt::format( "{:n} {:n} {:n} {:n}", 0, 999, 1000, -1234567 ) == "0 999 1,000 -1,234,567" );
+	assert( ufmt::format( "{:n}", UINT64_MAX ) == "18,446,744,073,709,551,615" );
+	assert( ufmt::format( "{:n}", INT64_MIN ) == "-9,223,372,036,854,775,808" );
+	assert( ufmt::format( "{:+n} {:>8n}", 1000000, 12345 ) == "+1,000,000   12,345" );
+
+	// A first group of its own size, e.g. Indian, and separators longer than one byte
+	auto previous = ufmt::get_number_locale();
+
+	ufmt::set_number_locale( { ",", ".", 3, 2 } );
+	assert( ufmt::format( "{:n} {:n} {:n}", 123, 1234, 123456789 ) == "123 1,234 12,34,56,789" );
+
+	ufmt::set_number_locale( { "\u2009", ",", 4 } );
+	assert( ufmt::format( "{:n} {:n}", 12345678, 1234 ) == "1234\u20095678 1234" );
+
+	ufmt::set_number_locale( { "", "." } );
+	assert( ufmt::format( "{:n}", 1234567 ) == "1234567" );
+
+	ufmt::set_number_locale( previous );
+}
+
+void TestEncodeFormat()
+{
+	// RFC 4648 and RFC 3986 vectors, padded and unpadded tails
+	assert( ufmt::format( "{:m}|{:m}|{:m}|{:m}|{:m}", "", "f", "fo", "foo", "foobar" ) == "|Zg==|Zm8=|Zm9v|Zm9vYmFy" );
+	assert( ufmt::format( "{:r}|{:r}|{:r}|{:r}|{:r}", "f", "fo", "foo", "foob", "foobar" ) ==
+	        "MY======|MZXQ====|MZXW6===|MZXW6YQ=|MZXW6YTBOI======" );
+	assert( ufmt::format( "{:u}", "a b/c~d-e.f_g?h=%" ) == "a%20b%2Fc~d-e.f_g%3Fh%3D%25" );
+
+	// Byte spans, base64url swaps the two last symbols and drops the padding
+	const uint8_t bytes[] = { 0xFB, 0xFF, 0xBF, 0x00 };
+	assert( ufmt::format( "{:m} {:M}", std::span( bytes ), std::span( bytes ) ) == "+/+/AA== -_-_AA" );
+	assert( ufmt::format( "{:u}", std::span( bytes, 2 ) ) == "%FB%FF" );
+
+	// Width and alignment apply to the encoded text, wide strings encode their UTF-8 bytes
+	assert( ufmt::format( "[{:>8m}] [{:<6M}] [{:*^9u}]", "f", "fo", " " ) == "[    Zg==] [Zm8   ] [***%20***]" );
+	assert( ufmt::format( L"{:u}", L"\u00E9" ) == L"%C3%A9" );
+
+	// Long inputs, every length up to a few vector blocks so each kernel runs its bulk and tail paths
+	static constexpr char Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	static constexpr char Base32[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+
+	std::string blob;
+	for ( size_t i = 0; i < 200; ++i )
+		blob += char( ( i % 5 == 0 ) ? 'a' + i % 26 : i * 131 + 7 );
+
+	for ( size_t len = 0; len <= blob.size(); ++len )
+	{
+		auto in = std::string_view( blob ).substr( 0, len );
+		std::string base64, base32, percent;
+
+		for ( size_t j = 0; j < len; j += 3 )
+		{
+			uint32_t bits = 0;
+			for ( size_t k = 0; k < 3; ++k )
+				bits = bits << 8 | ( ( j + k < len ) ? uint8_t( in[j + k] ) : 0u );
+
+			for ( size_t k = 0; k < 4; ++k )
+				base64 += ( k <= len - j ) ? Alphabet[( bits >> ( 18 - 6 * k ) ) & 63] : '=';
+		}
+
+		for ( size_t j = 0; j < len; j += 5 )
+		{
+			uint64_t bits = 0;
+			for ( size_t k = 0; k < 5; ++k )
+				bits = bits << 8 | ( ( j + k < len ) ? uint8_t( in[j + k] ) : 0u );
+
+			auto numSymbols = ( std::min<size_t>( len - j, 5 ) * 8 + 4 ) / 5;
+			for ( size_t k = 0; k < 8; ++k )
+				base32 += ( k < numSymbols ) ? Base32[( bits >> ( 35 - 5 * k ) ) & 31] : '=';
+		}
+
+		for ( auto ch : in )
+		{
+			auto b = uint8_t( ch );
+			if ( isalnum( b ) || b == '-' || b == '.' || b == '_' || b == '~' )
+				percent += char( b );
+			else
+				percent += ufmt::format( "%{:02X}", unsigned( b ) );
+		}
+
+		assert( ufmt::format( "{:m}", in ) == base64 );
+		assert( ufmt::format( "{:r}", in ) == base32 );
+		assert( ufmt::format( "{:u}", in ) == percent );
+		assert( ufmt::format( "{:m}", std::span( reinterpret_cast<const uint8_t *>( in.data() ), len ) ) == base64 );
+	}
+}
+
+void TestWideIntegerPerformance()
+{
+#if defined(__SIZEOF_INT128__)
+	constexpr int NumRecords = 5000000;
+
+	printf( "128-bit integer performance test: %d records\n", NumRecords );
+
+	using uint128 = ufmt::detail::uint128_t;
+
+	size_t checksum[2] = { };
+
+	{
+		Stopwatch sw{ "split by hand time", NumRecords, "records" };
+
+		constexpr uint64_t ChunkDivisor = 10000000000000000000ull;
+
+		char buff[64];
+		for ( int i = 0; i < NumRecords; ++i )
+		{
+			auto value = ( uint128( uint32_t( i ) * 2654435761u ) << 64 ) | uint64_t( i );
+
+			// High part, then the low 19 digits zero-padded, as done before 128-bit support
+			auto high = value / ChunkDivisor;
+			auto low = uint64_t( value % ChunkDivisor );
+
+			if ( high >> 64 )
+				checksum[0] += ufmt::format_to_n( buff, sizeof( buff ), "{}{:019}{:019}", uint64_t( high / ChunkDivisor ), uint64_t( high % ChunkDivisor ), low );
+			else if ( high )
+				checksum[0] += ufmt::format_to_n( buff, sizeof( buff ), "{}{:019}", uint64_t( high ), low );
+			else
+				checksum[0] += ufmt::format_to_n( buff, sizeof( buff ), "{}", low );
+		}
+	}
+
+	{
+		Stopwatch sw{ "     one call time", NumRecords, "records" };
+
+		char buff[64];
+		for ( int i = 0; i < NumRecords; ++i )
+			checksum[1] += ufmt::format_to_n( buff, sizeof( buff ), "{}", ( uint128( uint32_t( i ) * 2654435761u ) << 64 ) | uint64_t( i ) );
+	}
+
+	printf( checksum[0] == checksum[1] ? " equal\n" : " ERROR: checksums differ\n" );
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 int main()
 {
 	if ( 0 )
@@ -101,6 +1043,10 @@ int main()
 		TestEqualFormat( "{:#016X}", -123456789ll );
 		TestEqualFormat( "{:#016b}", 123456789ll );
 		TestEqualFormat( "{:#016b}", -123456789ll );
+		TestEqualFormat( "{:#o}", 123456789ll );
+		TestEqualFormat( "{:>12}", -123456789ll );
+		TestEqualFormat( "{:12}", 123456789ll );
+		TestEqualFormat( "{:12}", "left" );
 		TestEqualFormat( "{:f}", 3.141592653458 );
 
 		TestEqualFormat( "{:.3f}", 3.141592653458 );
@@ -115,6 +1061,10 @@ int main()
 		TestEqualFormat( "{: #016.3F}", -3.141592653458 );
 
 		TestEqualFormat( "Hubble's H{0} {1} {2} km/sec/mpc.", "0", "=", 71 );
+
+		TestEqualFormat( "{:>8}", "\xC5\xBC\xC3\xB3\xC5\x82w" );
+		TestEqualFormat( "{:*^9}", "\xC3\xA4" );
+		TestEqualFormat( "{:<6}|", "h\xC3\xA9llo" );
 	}
 
 	char buff[16];
@@ -127,6 +1077,86 @@ int main()
 
 	}
 
+	if ( 1 )
+	{
+		TestBatchFormat();
+		TestParallelFormat();
+		TestHexFormat();
+		TestTranscodeFormat();
+		TestIovecFormat();
+		TestChronoFormat();
+		TestScanFormat();
+		TestFixedStringBounds();
+		TestJsonFormat();
+		TestDebugFormat();
+		TestLogFormat();
+		TestGroupingFormat();
+		TestEncodeFormat();
+	}
+
+	if ( 1 )
+	{
+		// Constant-evaluated formatting, the result is baked into the binary
+		static constexpr auto MetricName = []
+		{
+			std::array<char, 32> name { };
+			ufmt::format_to0( name, "requests.{}.{:04x}", "get", 255 );
+			return name;
+		}();
+
+		static_assert( std::string_view( MetricName.data() ) == "requests.get.00ff" );
+
+		// Capacity computed from the format string, never truncated
+		constexpr auto Header = ufmt::format<"{:>8}|{:<5}|">( -42, true );
+		static_assert( std::string_view( Header ) == "     -42|true |" && Header.capacity() == 20 );
+
+		constexpr auto Cut = ufmt::format<8>( "{} {}", "fixed", "string" );
+		static_assert( Cut.truncated() && std::string_view( Cut ) == "fixed st" );
+
+		// Escaped for JSON and logfmt as part of formatting
+		constexpr auto Quoted = ufmt::format<32>( "{:j} msg={:l}", "a \"b\"\n", "c d" );
+		static_assert( std::string_view( Quoted ) == R"("a \"b\"\n" msg="c d")" );
+
+		constexpr auto QuotedChars = ufmt::format<"{:j}{:l}{:l}">( '"', 'x', '=' );
+		static_assert( std::string_view( QuotedChars ) == R"("\""x"=")" );
+
+		// Debug representation, control characters and broken UTF-8 spelled out
+		constexpr auto Debug = ufmt::format<"{:?} {:?}">( "tab\t\x01\xFF", '\'' );
+		static_assert( std::string_view( Debug ) == R"("tab\t\u{1}\x{ff}" '\'')" );
+
+		// Thousands separators, constant expressions always use the default number_locale
+		constexpr auto Grouped = ufmt::format<"{:n}">( -1234567 );
+		static_assert( std::string_view( Grouped ) == "-1,234,567" );
+
+		// Encoded while formatting, no temporary string
+		constexpr auto Encoded = ufmt::format<"{:m} {:u}">( "user:pass", "a b&c" );
+		static_assert( std::string_view( Encoded ) == "dXNlcjpwYXNz a%20b%26c" );
+
+		// Every integer width, long and long long alike
+		constexpr auto Widths = ufmt::format<"{} {} {} {}">( int8_t( -128 ), short( -1 ), 1l, 2ll );
+		static_assert( std::string_view( Widths ) == "-128 -1 1 2" );
+
+#if defined(__SIZEOF_INT128__)
+		constexpr auto Wide = ufmt::format<"{}">( ~ufmt::detail::uint128_t( 0 ) );
+		static_assert( std::string_view( Wide ) == "340282366920938463463374607431768211455" );
+#endif
+	}
+
+	if ( 1 )
+	{
+		// Allocator-aware outputs, everything below lives in the arena
+		char arena[1024];
+		std::pmr::monotonic_buffer_resource resource( arena, sizeof( arena ), std::pmr::null_memory_resource() );
+		std::pmr::polymorphic_allocator<> alloc( &resource );
+
+		auto pmrResult = ufmt::format( alloc, "{} {}", std::pmr::string( "formatted into a monotonic arena:", alloc ), 42 );
+		ufmt::format_to( pmrResult, "{:>4}", "!" );
+
+		assert( pmrResult == "formatted into a monotonic arena: 42   !" );
+		assert( pmrResult.get_allocator().resource() == &resource );
+		assert( pmrResult.data() >= arena && pmrResult.data() < arena + sizeof( arena ) );
+	}
+
 	if ( 0 )
 	{
 		TestPerformance( "{:.3f}", 3.141592653458 );
@@ -134,5 +1164,22 @@ int main()
 		TestPerformance( "Some {} with some {}: {} {} {}", "text", "values", 123456789ull, 999999999999.0, 0.0f );
 	}
 
+	if ( 0 )
+	{
+		TestBatchPerformance();
+		TestParallelPerformance();
+		TestMmapPerformance();
+		TestScanPerformance();
+		TestFixedStringPerformance();
+		TestJsonPerformance();
+		TestDebugPerformance();
+		TestGroupingPerformance();
+		TestWideIntegerPerformance();
+	}
+
+#if defined(UFMT_STATS)
+	fputs( ufmt::dump_format_stats().c_str(), stdout );
+#endif
+
 	return 0;
 }